@@ -0,0 +1,448 @@
+#include "hanoitower.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <streambuf>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace
+{
+    using clock_type = std::chrono::steady_clock;
+
+    constexpr std::chrono::milliseconds min_duration{ 200 };
+
+    struct bench_result_type
+    {
+        std::string name;
+        std::uint_fast64_t iterations;
+        std::uint_fast64_t items;
+        double seconds;
+    };
+
+    class NullBuffer : public std::streambuf
+    {
+    protected:
+        std::streamsize xsputn(const char*, std::streamsize count) override
+        {
+            return count;
+        }
+
+        int_type overflow(int_type c) override
+        {
+            return traits_type::not_eof(c);
+        }
+    };
+
+    template<typename T>
+    void doNotOptimize(const T& value)
+    {
+        asm volatile("" : : "r,m"(value) : "memory");
+    }
+
+    template<typename Engine>
+    Engine makeEngine(std::size_t disks, std::size_t pegs = 3)
+    {
+        Engine engine{};
+        for (std::size_t peg{ 0 }; peg < pegs; ++peg)
+        {
+            engine.create(std::string(1, static_cast<char>('a' + peg)));
+        }
+        for (auto disk{ disks }; disk > 0; --disk)
+        {
+            engine.select(PegId{ 0 }).push(static_cast<Engine::tower_type::value_type>(disk));
+        }
+        return engine;
+    }
+
+    // Runs body (which performs `items` operations per call) until min_duration has elapsed.
+    template<typename Body>
+    bench_result_type measure(std::string name, std::uint_fast64_t items, Body&& body)
+    {
+        std::uint_fast64_t iterations{ 0 };
+        const auto start{ clock_type::now() };
+        auto elapsed{ clock_type::duration::zero() };
+        do
+        {
+            body();
+            ++iterations;
+            elapsed = clock_type::now() - start;
+        } while (elapsed < min_duration);
+
+        return { .name = std::move(name),
+                 .iterations = iterations,
+                 .items = items * iterations,
+                 .seconds = std::chrono::duration<double>(elapsed).count() };
+    }
+
+    template<typename Tower>
+    void benchTower(std::vector<bench_result_type>& results, std::string_view label)
+    {
+        constexpr std::uint_fast64_t disks{ 32 };
+        Tower tower{};
+        results.push_back(measure(std::string{ "tower/" }.append(label).append("/push_pop"), disks, [&tower]
+        {
+            for (auto disk{ disks }; disk > 0; --disk)
+            {
+                doNotOptimize(tower.push(static_cast<Tower::value_type>(disk)));
+            }
+            while (!tower.empty())
+            {
+                tower.pop();
+            }
+        }));
+
+        for (auto disk{ disks }; disk > disks / 2; --disk)
+        {
+            tower.push(static_cast<Tower::value_type>(disk));
+        }
+        results.push_back(measure(std::string{ "tower/" }.append(label).append("/placeable"), disks, [&tower]
+        {
+            for (std::uint_fast64_t disk{ 1 }; disk <= disks; ++disk)
+            {
+                doNotOptimize(tower.placeable(static_cast<Tower::value_type>(disk)));
+            }
+        }));
+    }
+
+    void benchEngine(std::vector<bench_result_type>& results)
+    {
+        constexpr std::size_t disks{ 16 };
+        const HanoiMoveView solution{ disks };
+
+        results.push_back(measure("engine/move/name", solution.size(), [&solution]
+        {
+            constexpr std::array<std::string_view, 3> names{ "a", "b", "c" };
+            auto engine{ makeEngine<TheTowerOfHanoi>(disks) };
+            for (auto&& [from, to]: solution)
+            {
+                doNotOptimize(engine.move(names[from], names[to]));
+            }
+        }));
+
+        results.push_back(measure("engine/move/id", solution.size(), [&solution]
+        {
+            auto engine{ makeEngine<TheTowerOfHanoi>(disks) };
+            for (auto&& [from, to]: solution)
+            {
+                doNotOptimize(engine.move(from, to));
+            }
+        }));
+
+        const std::vector<HanoiMove> moves(solution.begin(), solution.end());
+        results.push_back(measure("engine/apply", moves.size(), [&moves]
+        {
+            auto engine{ makeEngine<TheTowerOfHanoi>(disks) };
+            doNotOptimize(engine.apply(moves));
+        }));
+
+        results.push_back(measure("engine/concurrent/move", solution.size(), [&solution]
+        {
+            ConcurrentTowerOfHanoi engine{ 3, disks };
+            for (auto&& [from, to]: solution)
+            {
+                doNotOptimize(engine.move(from, to));
+            }
+        }));
+
+        results.push_back(measure("engine/concurrent/apply", moves.size(), [&moves]
+        {
+            ConcurrentTowerOfHanoi engine{ 3, disks };
+            doNotOptimize(engine.apply(moves));
+        }));
+
+        results.push_back(measure("engine/fixed/apply", moves.size(), [&moves]
+        {
+            FixedTowerOfHanoi<3, disks> engine{};
+            doNotOptimize(engine.apply(moves));
+        }));
+
+        results.push_back(measure("engine/fixed/solve", solution.size(), []
+        {
+            FixedTowerOfHanoi<3, disks> engine{};
+            doNotOptimize(engine.solve());
+        }));
+
+        results.push_back(measure("engine/fixed/table", TheTowerOfHanoiSolver::moveCount(12), []
+        {
+            FixedTowerOfHanoi<3, 12> engine{};
+            doNotOptimize(engine.solve());
+        }));
+    }
+
+    void benchParse(std::vector<bench_result_type>& results)
+    {
+        constexpr std::array<std::string_view, 7> inputs{ "a,c", "b,a", "a,c b,c a,b", "/undo", "/redo", "/quit",
+                                                          "bogus" };
+        results.push_back(measure("game/parse", inputs.size(), [&inputs]
+        {
+            for (auto input: inputs)
+            {
+                doNotOptimize(TheTowerOfHanoiGame::parse(input));
+            }
+        }));
+    }
+
+    void benchExecute(std::vector<bench_result_type>& results)
+    {
+        NullBuffer buffer{};
+        std::ostream os{ &buffer };
+        TheTowerOfHanoiGame game{ 9 };
+        results.push_back(measure("game/execute", 6, [&game, &os]
+        {
+            game.execute("a,b a,c b,c", os);
+            game.execute("c,b c,a b,a", os);
+        }));
+    }
+
+    // With tracing compiled in, every move goes into the ring and the writer drains it to /dev/null.
+    void benchTrace(std::vector<bench_result_type>& results)
+    {
+        constexpr std::size_t disks{ 16 };
+        const HanoiMoveView solution{ disks };
+        const HanoiTraceSession trace{ "/dev/null" };
+        results.push_back(measure("trace/move", solution.size(), [&solution]
+        {
+            auto engine{ makeEngine<TheTowerOfHanoi>(disks) };
+            for (auto&& [from, to]: solution)
+            {
+                doNotOptimize(engine.move(from, to));
+            }
+        }));
+    }
+
+    template<typename Engine>
+    void benchRules(std::vector<bench_result_type>& results, std::string_view label, std::size_t disks)
+    {
+        const auto count{ *HanoiRuleSolver::moveCount(makeEngine<Engine>(disks), disks, 0, 2) };
+        results.push_back(measure(std::string{ "rules/" }.append(label).append("/solve"), count, [disks]
+        {
+            auto engine{ makeEngine<Engine>(disks) };
+            doNotOptimize(HanoiRuleSolver::solve(engine, disks, 0, 2));
+        }));
+    }
+
+    void benchStartup(std::vector<bench_result_type>& results)
+    {
+        constexpr std::size_t disks{ 10'000'000 };
+        results.push_back(measure("game/start", disks, []
+        {
+            const TheTowerOfHanoiGame game{ disks };
+            doNotOptimize(game.engine().hash());
+        }));
+
+        const auto start{ HanoiLayout::parse("a:10000000..5000001 b:5000000..2,1 c:").value() };
+        results.push_back(measure("game/start_layout", disks, [&start]
+        {
+            const auto game{ TheTowerOfHanoiGame::from(start) };
+            doNotOptimize(game->engine().hash());
+        }));
+    }
+
+    void benchSolve(std::vector<bench_result_type>& results, std::size_t maxDisks)
+    {
+        for (std::size_t disks{ 10 }; disks <= maxDisks; ++disks)
+        {
+            results.push_back(measure("solver/" + std::to_string(disks), TheTowerOfHanoiSolver::moveCount(disks),
+                                      [disks]
+                                      {
+                                          auto engine{ makeEngine<TheTowerOfHanoi>(disks) };
+                                          doNotOptimize(TheTowerOfHanoiSolver::solve(engine, disks, PegId{ 0 },
+                                                                                     PegId{ 1 }, PegId{ 2 }));
+                                      }));
+        }
+    }
+
+    void benchBatch(std::vector<bench_result_type>& results)
+    {
+        constexpr std::size_t games{ 4096 };
+        constexpr std::size_t steps{ 64 };
+        using engine_type = HanoiBatchEngine<>;
+
+        std::vector<std::vector<engine_type::id_type>> from(steps, std::vector<engine_type::id_type>(games));
+        std::vector<std::vector<engine_type::id_type>> to(steps, std::vector<engine_type::id_type>(games));
+        std::uint64_t seed{ 0 };
+        for (std::size_t step{ 0 }; step < steps; ++step)
+        {
+            for (std::size_t game{ 0 }; game < games; ++game)
+            {
+                const auto random{ hanoiMix(seed++) };
+                from[step][game] = static_cast<engine_type::id_type>(random % 3);
+                to[step][game] = static_cast<engine_type::id_type>(random / 3 % 3);
+            }
+        }
+
+        engine_type engine{ games, 16 };
+        results.push_back(measure("batch/step", games * steps, [&]
+        {
+            for (std::size_t step{ 0 }; step < steps; ++step)
+            {
+                doNotOptimize(engine.step(from[step], to[step]));
+            }
+        }));
+    }
+
+    void benchPacked(std::vector<bench_result_type>& results)
+    {
+        constexpr std::size_t disks{ 16 };
+        const HanoiMoveView solution{ disks };
+        const std::vector<HanoiMove> moves(solution.begin(), solution.end());
+        results.push_back(measure("packed/apply", moves.size(), [&moves]
+        {
+            PackedTowerOfHanoi engine{ 3, disks };
+            doNotOptimize(engine.apply(moves));
+        }));
+
+        constexpr std::size_t huge{ 100'000'000 };
+        PackedTowerOfHanoi engine{ 3, huge };
+        PegId peg{ 0 };
+        results.push_back(measure("packed/fill", huge, [&engine, &peg]
+        {
+            engine.fill(peg = (peg + 1) % 3);
+            doNotOptimize(engine.words().data());
+        }));
+    }
+
+    void benchPersistent(std::vector<bench_result_type>& results)
+    {
+        constexpr std::size_t disks{ 16 };
+        const HanoiMoveView solution{ disks };
+        const PersistentTowerOfHanoi root{ 3, disks };
+        results.push_back(measure("persistent/move", solution.size(), [&solution, &root]
+        {
+            auto position{ root };
+            for (auto&& [from, to]: solution)
+            {
+                position = *position.move(from, to);
+            }
+            doNotOptimize(position.hash());
+        }));
+
+        results.push_back(measure("persistent/fork", 1, [&root]
+        {
+            auto branch{ root };
+            doNotOptimize(branch);
+        }));
+    }
+
+    void benchReplay(std::vector<bench_result_type>& results)
+    {
+        constexpr std::size_t disks{ 20 };
+        const HanoiMoveView solution{ disks };
+        HanoiJournal::container_type entries{};
+        entries.reserve(solution.size());
+        for (auto&& move: solution)
+        {
+            entries.push_back(HanoiJournal::encode(move));
+        }
+
+        const TheTowerOfHanoiGame game{ disks };
+        auto replay{ HanoiReplay::record(game.engine(), HanoiJournal{ std::move(entries), solution.size() }) };
+        std::uint64_t seed{ 0 };
+        results.push_back(measure("replay/seek", 1, [&replay, &seed, &solution]
+        {
+            replay->seek(hanoiMix(seed++) % (solution.size() + 1));
+            doNotOptimize(replay->cursor());
+        }));
+    }
+
+    void benchVerify(std::vector<bench_result_type>& results)
+    {
+        constexpr std::size_t disks{ 22 };
+        const HanoiMoveView solution{ disks };
+        const std::vector<HanoiMove> moves(solution.begin(), solution.end());
+
+        results.push_back(measure("verify/serial", moves.size(), [&moves]
+        {
+            doNotOptimize(HanoiVerifier::verify(disks, moves));
+        }));
+
+        HanoiThreadPool pool{};
+        results.push_back(measure("verify/parallel", moves.size(), [&moves, &pool]
+        {
+            doNotOptimize(HanoiVerifier::verify(disks, moves, pool));
+        }));
+    }
+
+    void benchRender(std::vector<bench_result_type>& results)
+    {
+        constexpr std::size_t disks{ 20 };
+        NullBuffer buffer{};
+        std::ostream os{ &buffer };
+
+        auto engine{ makeEngine<TheTowerOfHanoi>(disks) };
+        results.push_back(measure("render/full", 1, [&engine, &os]
+        {
+            os << engine << '\n';
+        }));
+
+        HanoiRenderer<TheTowerOfHanoi> renderer{};
+        const HanoiMoveView solution{ disks };
+        std::size_t index{ 0 };
+        results.push_back(measure("render/incremental", 1, [&]
+        {
+            if (index == solution.size())
+            {
+                engine = makeEngine<TheTowerOfHanoi>(disks);
+                renderer.invalidate();
+                index = 0;
+            }
+            auto move{ solution[static_cast<HanoiMoveView::difference_type>(index++)] };
+            engine.move(move.from, move.to);
+            renderer.markDirty(move.from);
+            renderer.markDirty(move.to);
+            renderer.render(engine, os);
+        }));
+    }
+
+    void print(std::ostream& os, const std::vector<bench_result_type>& results)
+    {
+        os << "{\n  \"benchmarks\": [";
+        for (std::size_t i{ 0 }; i < results.size(); ++i)
+        {
+            const auto& result{ results[i] };
+            os << (i == 0 ? "\n" : ",\n")
+               << "    { \"name\": \"" << result.name << '"'
+               << ", \"iterations\": " << result.iterations
+               << ", \"ns_per_item\": " << result.seconds * 1e9 / static_cast<double>(result.items)
+               << ", \"items_per_second\": " << static_cast<double>(result.items) / result.seconds
+               << " }";
+        }
+        os << "\n  ]\n}\n";
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    std::size_t maxDisks{ 30 };
+    if (argc > 1)
+    {
+        maxDisks = std::strtoull(argv[1], nullptr, 10);
+    }
+
+    std::vector<bench_result_type> results{};
+    benchTower<HanoiTower<std::uint_fast32_t>>(results, "deque");
+    benchTower<HanoiStaticTower<std::uint_fast32_t, 64>>(results, "static");
+    benchTower<HanoiTower<std::uint_fast32_t, HanoiBitboard<>>>(results, "bitboard");
+    benchEngine(results);
+    benchParse(results);
+    benchExecute(results);
+    benchStartup(results);
+    benchSolve(results, maxDisks);
+    benchRules<TheTowerOfHanoi>(results, "classic", 16);
+    benchRules<CyclicTowerOfHanoi>(results, "cyclic", 12);
+    benchRules<AdjacentTowerOfHanoi>(results, "adjacent", 10);
+    benchVerify(results);
+    benchPacked(results);
+    benchPersistent(results);
+    benchReplay(results);
+    benchTrace(results);
+    benchBatch(results);
+    benchRender(results);
+
+    print(std::cout, results);
+
+    return 0;
+}
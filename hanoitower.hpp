@@ -0,0 +1,6600 @@
+#pragma once
+
+#ifndef HANOITOWER_ENABLE_STATS
+#define HANOITOWER_ENABLE_STATS 1
+#endif
+
+#ifndef HANOITOWER_ENABLE_TIMERS
+#define HANOITOWER_ENABLE_TIMERS 0
+#endif
+
+#ifndef HANOITOWER_ENABLE_TRACE
+#define HANOITOWER_ENABLE_TRACE 0
+#endif
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cerrno>
+#include <concepts>
+#include <cstring>
+#include <condition_variable>
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <ranges>
+#include <span>
+#include <stack>
+#include <streambuf>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+// A fixed-capacity sequence whose elements live in raw storage: a slot's element is constructed on emplace_back()
+// and destroyed on pop_back(), so T need not be default-constructible and a slot is never assigned over. For a
+// trivially copyable T the copies, moves and destructor stay defaulted, so the vector, and a tower over it, can
+// still be memcpy'd as a whole.
+template<typename T, std::size_t N>
+class HanoiStaticVector
+{
+public:
+    using value_type = T;
+    using size_type = std::size_t;
+    using difference_type = std::ptrdiff_t;
+    using reference = value_type&;
+    using const_reference = const value_type&;
+    using iterator = value_type*;
+    using const_iterator = const value_type*;
+
+    static constexpr size_type capacity{ N };
+
+public:
+    constexpr HanoiStaticVector() = default;
+
+    constexpr HanoiStaticVector(const HanoiStaticVector&) requires std::is_trivially_copyable_v<T> = default;
+    constexpr HanoiStaticVector(HanoiStaticVector&&) requires std::is_trivially_copyable_v<T> = default;
+    constexpr HanoiStaticVector& operator=(const HanoiStaticVector&) requires std::is_trivially_copyable_v<T> = default;
+    constexpr HanoiStaticVector& operator=(HanoiStaticVector&&) requires std::is_trivially_copyable_v<T> = default;
+    constexpr ~HanoiStaticVector() requires std::is_trivially_destructible_v<T> = default;
+
+    constexpr HanoiStaticVector(const HanoiStaticVector& other)
+    {
+        for (const auto& value: other)
+        {
+            emplace_back(value);
+        }
+    }
+
+    constexpr HanoiStaticVector(HanoiStaticVector&& other) noexcept(std::is_nothrow_move_constructible_v<T>)
+    {
+        for (auto& value: other)
+        {
+            emplace_back(std::move(value));
+        }
+    }
+
+    constexpr HanoiStaticVector& operator=(const HanoiStaticVector& other)
+    {
+        if (this != &other)
+        {
+            clear();
+            for (const auto& value: other)
+            {
+                emplace_back(value);
+            }
+        }
+        return *this;
+    }
+
+    constexpr HanoiStaticVector& operator=(HanoiStaticVector&& other) noexcept(std::is_nothrow_move_constructible_v<T>)
+    {
+        if (this != &other)
+        {
+            clear();
+            for (auto& value: other)
+            {
+                emplace_back(std::move(value));
+            }
+        }
+        return *this;
+    }
+
+    constexpr ~HanoiStaticVector()
+    {
+        clear();
+    }
+
+    [[nodiscard]] constexpr bool empty() const
+    {
+        return m_size == 0;
+    }
+
+    [[nodiscard]] constexpr size_type size() const
+    {
+        return m_size;
+    }
+
+    [[nodiscard]] constexpr reference back()
+    {
+        return m_storage.data[m_size - 1];
+    }
+
+    [[nodiscard]] constexpr const_reference back() const
+    {
+        return m_storage.data[m_size - 1];
+    }
+
+    constexpr void push_back(const value_type& value)
+    {
+        emplace_back(value);
+    }
+
+    constexpr void push_back(value_type&& value)
+    {
+        emplace_back(std::move(value));
+    }
+
+    template<typename... Args>
+    constexpr reference emplace_back(Args&& ...args)
+    {
+        auto* slot{ std::construct_at(m_storage.data + m_size, std::forward<Args>(args)...) };
+        ++m_size;
+        return *slot;
+    }
+
+    constexpr void pop_back()
+    {
+        std::destroy_at(m_storage.data + --m_size);
+    }
+
+    constexpr void clear()
+    {
+        std::destroy_n(m_storage.data, m_size);
+        m_size = 0;
+    }
+
+    [[nodiscard]] constexpr iterator begin()
+    {
+        return m_storage.data;
+    }
+
+    [[nodiscard]] constexpr const_iterator begin() const
+    {
+        return m_storage.data;
+    }
+
+    [[nodiscard]] constexpr iterator end()
+    {
+        return m_storage.data + m_size;
+    }
+
+    [[nodiscard]] constexpr const_iterator end() const
+    {
+        return m_storage.data + m_size;
+    }
+
+    friend constexpr bool operator==(const HanoiStaticVector& lhs, const HanoiStaticVector& rhs)
+    {
+        return std::ranges::equal(lhs, rhs);
+    }
+
+private:
+    // The union leaves data's elements unconstructed until emplace_back() begins their lifetimes.
+    union storage_type
+    {
+        constexpr storage_type() requires std::is_trivially_default_constructible_v<T> = default;
+        constexpr ~storage_type() requires std::is_trivially_destructible_v<T> = default;
+
+        constexpr storage_type()
+        {
+        }
+
+        constexpr ~storage_type()
+        {
+        }
+
+        value_type data[N];
+    };
+
+private:
+    storage_type m_storage{};
+    size_type m_size{ 0 };
+};
+
+static_assert(std::is_trivially_copyable_v<HanoiStaticVector<std::uint8_t, 64>>);
+
+template<typename Sequence>
+concept bounded_sequence = requires { { Sequence::capacity } -> std::convertible_to<std::size_t>; };
+
+// Selects the tower constructors that trust their range to run from the largest disk to the smallest, building
+// the tower in one pass with no placeable() check per disk.
+struct hanoi_sorted_t
+{
+    explicit hanoi_sorted_t() = default;
+};
+
+inline constexpr hanoi_sorted_t hanoi_sorted{};
+
+template<std::totally_ordered T, typename Sequence = std::stack<T>::container_type>
+class HanoiTower
+{
+public:
+    using adapter_type = std::stack<T, Sequence>;
+    using container_type = adapter_type::container_type;
+    using value_type = adapter_type::value_type;
+    using size_type = adapter_type::size_type;
+    using reference = adapter_type::reference;
+    using const_reference = adapter_type::const_reference;
+
+public:
+    HanoiTower()
+            : m_stack{}
+    {
+    }
+
+    explicit HanoiTower(const adapter_type& stack)
+            : m_stack{ stack }
+    {
+    }
+
+    explicit HanoiTower(adapter_type&& stack)
+            : m_stack{ std::move(stack) }
+    {
+    }
+
+    explicit HanoiTower(container_type&& container)
+            : m_stack{ std::move(container) }
+    {
+    }
+
+    template<std::ranges::input_range R>
+    HanoiTower(hanoi_sorted_t, R&& disks)
+            : m_stack{ sortedContainer(std::forward<R>(disks)) }
+    {
+    }
+
+    template<typename Alloc> requires std::uses_allocator_v<container_type, Alloc>
+    explicit HanoiTower(const Alloc& allocator)
+            : m_stack(allocator)
+    {
+    }
+
+    template<std::ranges::input_range R, typename Alloc> requires std::uses_allocator_v<container_type, Alloc>
+    HanoiTower(hanoi_sorted_t, R&& disks, const Alloc& allocator)
+            : m_stack{ sortedContainer(std::forward<R>(disks), allocator) }
+    {
+    }
+
+    template<typename Alloc> requires std::uses_allocator_v<container_type, Alloc>
+    HanoiTower(const HanoiTower& other, const Alloc& allocator)
+            : m_stack(other.m_stack, allocator)
+    {
+    }
+
+    template<typename Alloc> requires std::uses_allocator_v<container_type, Alloc>
+    HanoiTower(HanoiTower&& other, const Alloc& allocator)
+            : m_stack(std::move(other.m_stack), allocator)
+    {
+    }
+
+    [[nodiscard]] const_reference top() const
+    {
+        return m_stack.top();
+    }
+
+    [[nodiscard]] bool empty() const
+    {
+        return m_stack.empty();
+    }
+
+    [[nodiscard]] size_type size() const
+    {
+        return m_stack.size();
+    }
+
+    [[nodiscard]] bool full() const
+    {
+        if constexpr (bounded_sequence<container_type>)
+        {
+            return size() == container_type::capacity;
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    [[nodiscard]] bool placeable(const_reference element) const
+    {
+        return !full() && (empty() || top() > element);
+    }
+
+    bool push(const_reference element)
+    {
+        if (placeable(element))
+        {
+            m_stack.push(element);
+            return true;
+        }
+        return false;
+    }
+
+    bool push(value_type&& element)
+    {
+        if (placeable(element))
+        {
+            m_stack.push(std::move(element));
+            return true;
+        }
+        return false;
+    }
+
+    // Constructs the disk in its final slot and takes it back out if it turns out to be larger than the one below.
+    template<typename... Args>
+    bool emplace(Args&& ...args)
+    {
+        if (full())
+        {
+            return false;
+        }
+
+        m_stack.emplace(std::forward<Args>(args)...);
+        if (size() == 1 || *std::prev(container().end(), 2) > m_stack.top())
+        {
+            return true;
+        }
+
+        m_stack.pop();
+        return false;
+    }
+
+    void pop()
+    {
+        m_stack.pop();
+    }
+
+    // Moves the top disk onto another tower without copying it.
+    bool transferTo(HanoiTower& to)
+    {
+        if (empty() || !to.placeable(top()))
+        {
+            return false;
+        }
+        to.m_stack.push(std::move(m_stack.top()));
+        m_stack.pop();
+        return true;
+    }
+
+    [[nodiscard]] const adapter_type& adapter() const
+    {
+        return m_stack;
+    }
+
+    [[nodiscard]] const container_type& container() const
+    {
+        struct StackHack : protected adapter_type
+        {
+            static const container_type& container(const adapter_type& base)
+            {
+                return static_cast<const StackHack&>(base).c;
+            }
+        };
+        return StackHack::container(m_stack);
+    }
+
+    template<std::invocable<const_reference> F>
+    void forEach(F&& f) const
+    {
+        for (auto&& e: container())
+        {
+            f(e);
+        }
+    }
+
+private:
+    template<std::ranges::input_range R, typename... Alloc>
+    static container_type sortedContainer(R&& disks, const Alloc&... allocator)
+    {
+        using iterator_type = std::ranges::iterator_t<R>;
+        if constexpr (std::ranges::common_range<R>
+                      && std::constructible_from<container_type, iterator_type, iterator_type, const Alloc&...>)
+        {
+            return container_type(std::ranges::begin(disks), std::ranges::end(disks), allocator...);
+        }
+        else
+        {
+            container_type container(allocator...);
+            if constexpr (std::ranges::sized_range<R> && requires { container.reserve(size_type{}); })
+            {
+                container.reserve(static_cast<size_type>(std::ranges::size(disks)));
+            }
+            for (auto&& disk: disks)
+            {
+                container.push_back(static_cast<value_type>(disk));
+            }
+            return container;
+        }
+    }
+
+    adapter_type m_stack;
+};
+
+template<std::totally_ordered T, typename Sequence = std::stack<T>::container_type>
+std::ostream& operator<<(std::ostream& os, const HanoiTower<T, Sequence>& adapter)
+{
+    for (auto&& e: adapter.container())
+    {
+        if constexpr (std::is_arithmetic_v<T>)
+        {
+            os << +e;
+        }
+        else
+        {
+            os << e;
+        }
+    }
+
+    return os;
+}
+
+// Lets allocator-aware containers of towers (e.g. a pmr engine) hand their allocator down to each peg.
+template<std::totally_ordered T, typename Sequence, typename Alloc>
+struct std::uses_allocator<HanoiTower<T, Sequence>, Alloc> : std::uses_allocator<Sequence, Alloc>
+{
+};
+
+template<std::totally_ordered T, std::size_t N>
+using HanoiStaticTower = HanoiTower<T, HanoiStaticVector<T, N>>;
+
+static_assert(std::is_trivially_copyable_v<HanoiStaticTower<std::uint8_t, 64>>);
+
+template<std::unsigned_integral Word = std::uint64_t>
+class HanoiBitboard
+{
+public:
+    using word_type = Word;
+    using size_type = std::size_t;
+
+    static constexpr size_type capacity{ std::numeric_limits<word_type>::digits };
+
+public:
+    constexpr HanoiBitboard() = default;
+
+    constexpr explicit HanoiBitboard(word_type word)
+            : m_word{ word }
+    {
+    }
+
+    [[nodiscard]] constexpr word_type word() const
+    {
+        return m_word;
+    }
+
+    [[nodiscard]] constexpr word_type& word()
+    {
+        return m_word;
+    }
+
+    friend constexpr bool operator==(const HanoiBitboard&, const HanoiBitboard&) = default;
+
+private:
+    word_type m_word{ 0 };
+};
+
+template<std::totally_ordered T, std::unsigned_integral Word> requires std::unsigned_integral<T>
+class HanoiTower<T, HanoiBitboard<Word>>
+{
+public:
+    using adapter_type = HanoiBitboard<Word>;
+    using container_type = adapter_type;
+    using word_type = adapter_type::word_type;
+    using value_type = T;
+    using size_type = adapter_type::size_type;
+    using reference = value_type;
+    using const_reference = value_type;
+
+    static constexpr size_type capacity{ adapter_type::capacity };
+
+public:
+    constexpr HanoiTower()
+            : m_board{}
+    {
+    }
+
+    constexpr explicit HanoiTower(const adapter_type& board)
+            : m_board{ board }
+    {
+    }
+
+    template<std::ranges::input_range R>
+    constexpr HanoiTower(hanoi_sorted_t, R&& disks)
+            : m_board{}
+    {
+        for (auto&& disk: disks)
+        {
+            m_board.word() |= bit(static_cast<value_type>(disk));
+        }
+    }
+
+    [[nodiscard]] constexpr const_reference top() const
+    {
+        return static_cast<value_type>(std::countr_zero(m_board.word()) + 1);
+    }
+
+    [[nodiscard]] constexpr bool empty() const
+    {
+        return m_board.word() == 0;
+    }
+
+    [[nodiscard]] constexpr size_type size() const
+    {
+        return static_cast<size_type>(std::popcount(m_board.word()));
+    }
+
+    [[nodiscard]] constexpr bool placeable(const_reference element) const
+    {
+        return static_cast<size_type>(element) - 1 < capacity && (m_board.word() & lowerMask(element)) == 0;
+    }
+
+    constexpr bool push(const_reference element)
+    {
+        if (placeable(element))
+        {
+            m_board.word() |= bit(element);
+            return true;
+        }
+        return false;
+    }
+
+    template<typename... Args>
+    constexpr bool emplace(Args&& ...args)
+    {
+        return push(value_type{ std::forward<Args>(args)... });
+    }
+
+    constexpr void pop()
+    {
+        m_board.word() &= m_board.word() - 1;
+    }
+
+    constexpr bool transferTo(HanoiTower& to)
+    {
+        if (empty() || !to.push(top()))
+        {
+            return false;
+        }
+        pop();
+        return true;
+    }
+
+    [[nodiscard]] constexpr const adapter_type& adapter() const
+    {
+        return m_board;
+    }
+
+    template<std::invocable<const_reference> F>
+    constexpr void forEach(F&& f) const
+    {
+        for (auto word{ m_board.word() }; word != 0; word &= ~std::bit_floor(word))
+        {
+            f(static_cast<value_type>(std::bit_width(word)));
+        }
+    }
+
+private:
+    [[nodiscard]] static constexpr word_type bit(const_reference element)
+    {
+        return word_type{ 1 } << (element - 1);
+    }
+
+    // Every disk no larger than element: a bitboard tower accepts element only if none of them are present.
+    [[nodiscard]] static constexpr word_type lowerMask(const_reference element)
+    {
+        return static_cast<word_type>((bit(element) << 1) - 1);
+    }
+
+private:
+    adapter_type m_board;
+};
+
+template<std::totally_ordered T, std::unsigned_integral Word> requires std::unsigned_integral<T>
+std::ostream& operator<<(std::ostream& os, const HanoiTower<T, HanoiBitboard<Word>>& tower)
+{
+    tower.forEach([&os](T disk)
+                  {
+                      os << +disk;
+                  });
+
+    return os;
+}
+
+enum class HanoiCounter : std::size_t
+{
+    moves,
+    rejected_moves,
+    lookup_misses,
+    count
+};
+
+enum class HanoiTimer : std::size_t
+{
+    parse,
+    render,
+    count
+};
+
+class HanoiStats
+{
+public:
+    using value_type = std::uint_fast64_t;
+    using clock_type = std::chrono::steady_clock;
+
+    static constexpr bool enabled{ HANOITOWER_ENABLE_STATS != 0 };
+    static constexpr bool timers_enabled{ HANOITOWER_ENABLE_TIMERS != 0 };
+    static constexpr std::size_t counter_count{ static_cast<std::size_t>(HanoiCounter::count) };
+    static constexpr std::size_t timer_count{ static_cast<std::size_t>(HanoiTimer::count) };
+
+    struct snapshot_type
+    {
+        std::array<value_type, counter_count> counters{};
+        std::array<value_type, timer_count> nanoseconds{};
+        clock_type::duration uptime{};
+
+        [[nodiscard]] value_type counter(HanoiCounter counter) const
+        {
+            return counters[static_cast<std::size_t>(counter)];
+        }
+
+        [[nodiscard]] std::chrono::nanoseconds time(HanoiTimer timer) const
+        {
+            return std::chrono::nanoseconds{ nanoseconds[static_cast<std::size_t>(timer)] };
+        }
+
+        [[nodiscard]] double rate(HanoiCounter counter) const
+        {
+            const auto seconds{ std::chrono::duration<double>(uptime).count() };
+            return seconds > 0 ? static_cast<double>(this->counter(counter)) / seconds : 0;
+        }
+    };
+
+public:
+    static void increment(HanoiCounter counter, value_type amount = 1)
+    {
+        if constexpr (enabled)
+        {
+            add(local().counters[static_cast<std::size_t>(counter)], amount);
+        }
+    }
+
+    static void record(HanoiTimer timer, clock_type::duration elapsed)
+    {
+        if constexpr (enabled)
+        {
+            add(local().nanoseconds[static_cast<std::size_t>(timer)],
+                static_cast<value_type>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+        }
+    }
+
+    [[nodiscard]] static snapshot_type snapshot()
+    {
+        auto& registry{ HanoiStats::registry() };
+        std::scoped_lock lock{ registry.mutex };
+
+        auto result{ registry.retired };
+        for (const auto* block: registry.blocks)
+        {
+            accumulate(result, *block);
+        }
+        result.uptime = clock_type::now() - registry.start;
+        return result;
+    }
+
+private:
+    struct block_type
+    {
+        std::array<std::atomic<value_type>, counter_count> counters{};
+        std::array<std::atomic<value_type>, timer_count> nanoseconds{};
+    };
+
+    struct registry_type
+    {
+        std::mutex mutex{};
+        std::vector<const block_type*> blocks{};
+        snapshot_type retired{};
+        clock_type::time_point start{ clock_type::now() };
+    };
+
+    struct local_type
+    {
+        local_type()
+        {
+            auto& registry{ HanoiStats::registry() };
+            std::scoped_lock lock{ registry.mutex };
+            registry.blocks.push_back(&block);
+        }
+
+        local_type(const local_type&) = delete;
+        local_type& operator=(const local_type&) = delete;
+
+        ~local_type()
+        {
+            auto& registry{ HanoiStats::registry() };
+            std::scoped_lock lock{ registry.mutex };
+            accumulate(registry.retired, block);
+            std::erase(registry.blocks, &block);
+        }
+
+        block_type block{};
+    };
+
+    // Each slot has a single writer, so a relaxed load/store pair is enough and avoids a locked add.
+    static void add(std::atomic<value_type>& slot, value_type amount)
+    {
+        slot.store(slot.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+    }
+
+    static void accumulate(snapshot_type& snapshot, const block_type& block)
+    {
+        for (std::size_t i{ 0 }; i < counter_count; ++i)
+        {
+            snapshot.counters[i] += block.counters[i].load(std::memory_order_relaxed);
+        }
+        for (std::size_t i{ 0 }; i < timer_count; ++i)
+        {
+            snapshot.nanoseconds[i] += block.nanoseconds[i].load(std::memory_order_relaxed);
+        }
+    }
+
+    static registry_type& registry()
+    {
+        static registry_type registry{};
+        return registry;
+    }
+
+    static block_type& local()
+    {
+        thread_local local_type local{};
+        return local.block;
+    }
+};
+
+inline std::ostream& operator<<(std::ostream& os, const HanoiStats::snapshot_type& snapshot)
+{
+    os << "moves: " << snapshot.counter(HanoiCounter::moves)
+       << " (" << snapshot.rate(HanoiCounter::moves) << "/s)\n"
+       << "rejected_moves: " << snapshot.counter(HanoiCounter::rejected_moves) << '\n'
+       << "lookup_misses: " << snapshot.counter(HanoiCounter::lookup_misses) << '\n'
+       << "parse_ns: " << snapshot.time(HanoiTimer::parse).count() << '\n'
+       << "render_ns: " << snapshot.time(HanoiTimer::render).count() << '\n';
+    return os;
+}
+
+#if HANOITOWER_ENABLE_TIMERS
+
+class HanoiScopedTimer
+{
+public:
+    explicit HanoiScopedTimer(HanoiTimer timer)
+            : m_timer{ timer }, m_start{ HanoiStats::clock_type::now() }
+    {
+    }
+
+    HanoiScopedTimer(const HanoiScopedTimer&) = delete;
+    HanoiScopedTimer& operator=(const HanoiScopedTimer&) = delete;
+
+    ~HanoiScopedTimer()
+    {
+        HanoiStats::record(m_timer, HanoiStats::clock_type::now() - m_start);
+    }
+
+private:
+    HanoiTimer m_timer;
+    HanoiStats::clock_type::time_point m_start;
+};
+
+#else
+
+class HanoiScopedTimer
+{
+public:
+    constexpr explicit HanoiScopedTimer(HanoiTimer)
+    {
+    }
+};
+
+#endif
+
+enum class HanoiEvent : std::uint8_t
+{
+    move,
+    rejected_move,
+    apply,
+    solve,
+    batch_step,
+    parse,
+    render,
+    undo,
+    redo,
+    count
+};
+
+// An optional timeline of engine and game events. Each thread records into its own single-producer ring and a
+// background writer drains every ring into a Chrome trace / Perfetto JSON file; a full ring drops events rather
+// than stall the traced thread. With HANOITOWER_ENABLE_TRACE off every call compiles away, and with it on but no
+// trace started an event costs one relaxed load.
+class HanoiTrace
+{
+public:
+    using value_type = std::uint64_t;
+    using clock_type = std::chrono::steady_clock;
+
+    static constexpr bool enabled{ HANOITOWER_ENABLE_TRACE != 0 };
+    static constexpr std::size_t ring_capacity{ std::size_t{ 1 } << 14 };
+    static constexpr std::chrono::milliseconds flush_interval{ 20 };
+
+    // Spans carry a duration; instants leave it at zero. generation is that of the trace the event was recorded
+    // for, so the writer can skip one that a thread pushed too late for an earlier trace.
+    struct event_type
+    {
+        value_type start{ 0 };
+        value_type duration{ 0 };
+        value_type first{ 0 };
+        value_type second{ 0 };
+        std::uint32_t generation{ 0 };
+        HanoiEvent type{ HanoiEvent::count };
+        bool span{ false };
+    };
+
+public:
+    // Fails when tracing is compiled out, a trace is already running or path cannot be created.
+    static bool start(const char* path)
+    {
+        if constexpr (enabled)
+        {
+            auto& registry{ HanoiTrace::registry() };
+            std::scoped_lock lock{ registry.mutex };
+            if (registry.fd >= 0)
+            {
+                return false;
+            }
+            registry.fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+            if (registry.fd < 0)
+            {
+                return false;
+            }
+
+            // Whatever the rings still hold belongs to no trace, and rings of exited threads are no longer needed.
+            for (auto& ring: registry.rings)
+            {
+                ring->tail.store(ring->head.load(std::memory_order_acquire), std::memory_order_relaxed);
+            }
+            reclaim(registry);
+            registry.output.assign("{\"traceEvents\":[");
+            registry.separator = false;
+            registry.traced = registry.generation.fetch_add(1, std::memory_order_release) + 1;
+            registry.writer = std::jthread{ [](std::stop_token token)
+                                            {
+                                                write(token);
+                                            } };
+            return true;
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    // Drains what is left, closes the JSON document and the file, and frees the rings of exited threads.
+    static void stop()
+    {
+        if constexpr (enabled)
+        {
+            auto& registry{ HanoiTrace::registry() };
+            std::unique_lock lock{ registry.mutex };
+            if (!tracing(registry.generation.load(std::memory_order_relaxed)))
+            {
+                return;
+            }
+            registry.generation.fetch_add(1, std::memory_order_release);
+
+            // The writer drains under the lock, so it is joined without it.
+            auto writer{ std::move(registry.writer) };
+            lock.unlock();
+            writer = std::jthread{};
+            lock.lock();
+
+            drain(registry);
+            registry.output.append("]}\n");
+            flushOutput(registry);
+            ::close(std::exchange(registry.fd, -1));
+        }
+    }
+
+    [[nodiscard]] static bool active()
+    {
+        if constexpr (enabled)
+        {
+            return tracing(registry().generation.load(std::memory_order_relaxed));
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    // Rings held for threads that have traced: live ones, and exited ones a running trace has yet to drain.
+    [[nodiscard]] static std::size_t rings()
+    {
+        auto& registry{ HanoiTrace::registry() };
+        std::scoped_lock lock{ registry.mutex };
+        return registry.rings.size();
+    }
+
+    // Events lost to full rings since the process started.
+    [[nodiscard]] static value_type dropped()
+    {
+        auto& registry{ HanoiTrace::registry() };
+        std::scoped_lock lock{ registry.mutex };
+        auto total{ registry.retiredDrops };
+        for (const auto& ring: registry.rings)
+        {
+            total += ring->dropped.load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+    static void instant(HanoiEvent type, value_type first = 0, value_type second = 0)
+    {
+        if constexpr (enabled)
+        {
+            if (const auto generation{ registry().generation.load(std::memory_order_relaxed) }; tracing(generation))
+            {
+                push({ .start = since(clock_type::now()), .first = first, .second = second, .generation = generation,
+                       .type = type });
+            }
+        }
+    }
+
+    static void complete(HanoiEvent type, clock_type::time_point start, value_type first = 0, value_type second = 0)
+    {
+        if constexpr (enabled)
+        {
+            if (const auto generation{ registry().generation.load(std::memory_order_relaxed) }; tracing(generation))
+            {
+                const auto begin{ since(start) };
+                push({ .start = begin, .duration = since(clock_type::now()) - begin, .first = first, .second = second,
+                       .generation = generation, .type = type, .span = true });
+            }
+        }
+    }
+
+private:
+    struct ring_type
+    {
+        std::array<event_type, ring_capacity> events{};
+        alignas(64) std::atomic<std::size_t> head{ 0 };
+        alignas(64) std::atomic<std::size_t> tail{ 0 };
+        std::atomic<value_type> dropped{ 0 };
+        std::atomic<bool> retired{ false };
+        value_type thread{ 0 };
+    };
+
+    struct registry_type
+    {
+        std::mutex mutex{};
+        std::vector<std::shared_ptr<ring_type>> rings{};
+        value_type retiredDrops{ 0 };
+        value_type threads{ 0 };
+        clock_type::time_point epoch{ clock_type::now() };
+        // Odd while a trace runs; start() and stop() each advance it, and traced is the running trace's value.
+        std::atomic<std::uint32_t> generation{ 0 };
+        std::uint32_t traced{ 0 };
+        int fd{ -1 };
+        std::string output{};
+        bool separator{ false };
+        std::jthread writer{};
+    };
+
+    // The registry shares each ring with its thread, so a thread may exit while the writer is still draining it.
+    struct local_type
+    {
+        local_type()
+                : ring{ std::make_shared<ring_type>() }
+        {
+            auto& registry{ HanoiTrace::registry() };
+            std::scoped_lock lock{ registry.mutex };
+            ring->thread = ++registry.threads;
+            registry.rings.push_back(ring);
+        }
+
+        local_type(const local_type&) = delete;
+        local_type& operator=(const local_type&) = delete;
+
+        // With no trace running nothing will drain the ring again, so it is freed here rather than left to the
+        // next trace.
+        ~local_type()
+        {
+            auto& registry{ HanoiTrace::registry() };
+            std::scoped_lock lock{ registry.mutex };
+            ring->retired.store(true, std::memory_order_release);
+            if (registry.fd < 0)
+            {
+                reclaim(registry);
+            }
+        }
+
+        std::shared_ptr<ring_type> ring;
+    };
+
+    struct name_type
+    {
+        std::string_view name;
+        std::string_view first;
+        std::string_view second;
+    };
+
+    static constexpr std::array<name_type, static_cast<std::size_t>(HanoiEvent::count)> names{ {
+            { "move", "from", "to" },
+            { "rejected_move", "from", "to" },
+            { "apply", "moves", "applied" },
+            { "solve", "disks", "moves" },
+            { "batch_step", "games", "accepted" },
+            { "parse", "bytes", "" },
+            { "render", "", "" },
+            { "undo", "from", "to" },
+            { "redo", "from", "to" }
+    } };
+
+    [[nodiscard]] static constexpr bool tracing(std::uint32_t generation)
+    {
+        return generation % 2 != 0;
+    }
+
+    [[nodiscard]] static value_type since(clock_type::time_point time)
+    {
+        return static_cast<value_type>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(time - registry().epoch).count());
+    }
+
+    // The owning thread is the ring's only producer: it publishes with a release store of head, and the writer
+    // frees slots with a release store of tail.
+    static void push(const event_type& event)
+    {
+        auto& ring{ *local().ring };
+        const auto head{ ring.head.load(std::memory_order_relaxed) };
+        if (head - ring.tail.load(std::memory_order_acquire) == ring_capacity)
+        {
+            ring.dropped.store(ring.dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return;
+        }
+        ring.events[head % ring_capacity] = event;
+        ring.head.store(head + 1, std::memory_order_release);
+    }
+
+    static void write(std::stop_token token)
+    {
+        auto& registry{ HanoiTrace::registry() };
+        std::mutex mutex{};
+        std::condition_variable_any wake{};
+        while (!token.stop_requested())
+        {
+            {
+                std::unique_lock lock{ mutex };
+                wake.wait_for(lock, token, flush_interval, [] { return false; });
+            }
+            std::scoped_lock lock{ registry.mutex };
+            drain(registry);
+            flushOutput(registry);
+        }
+    }
+
+    // Called with the registry locked. Rings of exited threads are dropped once they are empty.
+    static void drain(registry_type& registry)
+    {
+        for (auto& ring: registry.rings)
+        {
+            const auto head{ ring->head.load(std::memory_order_acquire) };
+            for (auto tail{ ring->tail.load(std::memory_order_relaxed) }; tail != head; ++tail)
+            {
+                if (const auto& event{ ring->events[tail % ring_capacity] }; event.generation == registry.traced)
+                {
+                    format(registry, ring->thread, event);
+                }
+            }
+            ring->tail.store(head, std::memory_order_release);
+        }
+        reclaim(registry);
+    }
+
+    // Called with the registry locked; frees the rings of exited threads, whatever they still hold.
+    static void reclaim(registry_type& registry)
+    {
+        std::erase_if(registry.rings, [&registry](const std::shared_ptr<ring_type>& ring)
+        {
+            if (!ring->retired.load(std::memory_order_acquire))
+            {
+                return false;
+            }
+            registry.retiredDrops += ring->dropped.load(std::memory_order_relaxed);
+            return true;
+        });
+    }
+
+    static void format(registry_type& registry, value_type thread, const event_type& event)
+    {
+        const auto& [name, first, second]{ names[static_cast<std::size_t>(event.type)] };
+        auto& output{ registry.output };
+        output.append(std::exchange(registry.separator, true) ? ",\n{\"name\":\"" : "\n{\"name\":\"").append(name);
+        output.append(event.span ? "\",\"ph\":\"X\",\"ts\":" : "\",\"ph\":\"i\",\"s\":\"t\",\"ts\":");
+        appendMicroseconds(output, event.start);
+        if (event.span)
+        {
+            output.append(",\"dur\":");
+            appendMicroseconds(output, event.duration);
+        }
+        output.append(",\"pid\":1,\"tid\":");
+        appendNumber(output, thread);
+        output.append(",\"args\":{");
+        if (!first.empty())
+        {
+            output.append("\"").append(first).append("\":");
+            appendNumber(output, event.first);
+        }
+        if (!second.empty())
+        {
+            output.append(",\"").append(second).append("\":");
+            appendNumber(output, event.second);
+        }
+        output.append("}}");
+    }
+
+    static void appendNumber(std::string& output, value_type value)
+    {
+        std::array<char, std::numeric_limits<value_type>::digits10 + 1> digits{};
+        const auto [end, error]{ std::to_chars(digits.data(), digits.data() + digits.size(), value) };
+        output.append(digits.data(), end);
+    }
+
+    // Chrome traces count in microseconds; three decimals keep the nanoseconds.
+    static void appendMicroseconds(std::string& output, value_type nanoseconds)
+    {
+        appendNumber(output, nanoseconds / 1000);
+        const auto fraction{ nanoseconds % 1000 };
+        output.push_back('.');
+        output.push_back(static_cast<char>('0' + fraction / 100));
+        output.push_back(static_cast<char>('0' + fraction / 10 % 10));
+        output.push_back(static_cast<char>('0' + fraction % 10));
+    }
+
+    static void flushOutput(registry_type& registry)
+    {
+        std::size_t written{ 0 };
+        while (written < registry.output.size())
+        {
+            const auto result{ ::write(registry.fd, registry.output.data() + written,
+                                       registry.output.size() - written) };
+            if (result < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (result <= 0)
+            {
+                break;
+            }
+            written += static_cast<std::size_t>(result);
+        }
+        registry.output.clear();
+    }
+
+    static registry_type& registry()
+    {
+        static registry_type registry{};
+        return registry;
+    }
+
+    static local_type& local()
+    {
+        thread_local local_type local{};
+        return local;
+    }
+};
+
+#if HANOITOWER_ENABLE_TRACE
+
+// Records one span from construction to destruction; arguments() fills in results known only at the end.
+class HanoiTraceSpan
+{
+public:
+    explicit HanoiTraceSpan(HanoiEvent type, HanoiTrace::value_type first = 0, HanoiTrace::value_type second = 0)
+            : m_type{ type },
+              m_first{ first },
+              m_second{ second },
+              m_start{ HanoiTrace::active() ? HanoiTrace::clock_type::now() : HanoiTrace::clock_type::time_point{} }
+    {
+    }
+
+    HanoiTraceSpan(const HanoiTraceSpan&) = delete;
+    HanoiTraceSpan& operator=(const HanoiTraceSpan&) = delete;
+
+    ~HanoiTraceSpan()
+    {
+        if (m_start != HanoiTrace::clock_type::time_point{})
+        {
+            HanoiTrace::complete(m_type, m_start, m_first, m_second);
+        }
+    }
+
+    void arguments(HanoiTrace::value_type first, HanoiTrace::value_type second)
+    {
+        m_first = first;
+        m_second = second;
+    }
+
+private:
+    HanoiEvent m_type;
+    HanoiTrace::value_type m_first;
+    HanoiTrace::value_type m_second;
+    HanoiTrace::clock_type::time_point m_start;
+};
+
+#else
+
+class HanoiTraceSpan
+{
+public:
+    constexpr explicit HanoiTraceSpan(HanoiEvent, HanoiTrace::value_type = 0, HanoiTrace::value_type = 0)
+    {
+    }
+
+    constexpr void arguments(HanoiTrace::value_type, HanoiTrace::value_type)
+    {
+    }
+};
+
+#endif
+
+// Keeps a trace running for its own lifetime and stops it on every way out of the scope; a null path, or a trace
+// that fails to start, leaves the session inert.
+class HanoiTraceSession
+{
+public:
+    explicit HanoiTraceSession(const char* path)
+            : m_ok{ path != nullptr && HanoiTrace::start(path) }
+    {
+    }
+
+    HanoiTraceSession(const HanoiTraceSession&) = delete;
+    HanoiTraceSession& operator=(const HanoiTraceSession&) = delete;
+
+    ~HanoiTraceSession()
+    {
+        if (m_ok)
+        {
+            HanoiTrace::stop();
+        }
+    }
+
+    [[nodiscard]] bool ok() const
+    {
+        return m_ok;
+    }
+
+private:
+    bool m_ok;
+};
+
+using PegId = std::size_t;
+
+[[nodiscard]] constexpr std::uint64_t hanoiMix(std::uint64_t value)
+{
+    value += 0x9E3779B97F4A7C15;
+    value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9;
+    value = (value ^ (value >> 27)) * 0x94D049BB133111EB;
+    return value ^ (value >> 31);
+}
+
+struct HanoiMove
+{
+    PegId from;
+    PegId to;
+
+    friend constexpr bool operator==(const HanoiMove&, const HanoiMove&) = default;
+};
+
+struct HanoiClassicRules;
+
+template<typename Tower = HanoiTower<std::uint_fast32_t>, typename Allocator = std::allocator<std::byte>,
+        typename Rules = HanoiClassicRules>
+class BasicTowerOfHanoi
+{
+public:
+    using tower_type = Tower;
+    using allocator_type = Allocator;
+    using rules_type = Rules;
+    using name_type = std::basic_string<char, std::char_traits<char>,
+            typename std::allocator_traits<allocator_type>::template rebind_alloc<char>>;
+    using value_type = std::pair<name_type, tower_type>;
+    using container_type = std::vector<value_type,
+            typename std::allocator_traits<allocator_type>::template rebind_alloc<value_type>>;
+    using key_type = std::string_view;
+    using mapped_type = tower_type;
+    using id_type = PegId;
+    using size_type = container_type::size_type;
+    struct create_result_type
+    {
+        container_type::iterator iterator;
+        bool ok{ false };
+    };
+    struct apply_result_type
+    {
+        bool ok{ false };
+        std::size_t index{ 0 };
+    };
+
+public:
+    explicit BasicTowerOfHanoi()
+            : m_pegs{}
+    {
+    }
+
+    explicit BasicTowerOfHanoi(const allocator_type& allocator)
+            : m_pegs(allocator)
+    {
+    }
+
+    [[nodiscard]] allocator_type get_allocator() const
+    {
+        return allocator_type{ m_pegs.get_allocator() };
+    }
+
+    [[nodiscard]] bool has(key_type name) const
+    {
+        return resolve(name).has_value();
+    }
+
+    [[nodiscard]] bool has(id_type id) const
+    {
+        return id < m_pegs.size();
+    }
+
+    [[nodiscard]] std::optional<id_type> resolve(key_type name) const
+    {
+        auto id{ find(name) };
+        if (!id)
+        {
+            HanoiStats::increment(HanoiCounter::lookup_misses);
+        }
+        return id;
+    }
+
+    [[nodiscard]] id_type id(key_type name) const
+    {
+        if (auto id{ resolve(name) })
+        {
+            return *id;
+        }
+        throw std::out_of_range{ "BasicTowerOfHanoi::id" };
+    }
+
+    [[nodiscard]] key_type name(id_type id) const
+    {
+        return m_pegs[id].first;
+    }
+
+    [[nodiscard]] size_type size() const
+    {
+        return m_pegs.size();
+    }
+
+    void reserve(size_type pegs)
+    {
+        m_pegs.reserve(pegs);
+    }
+
+    create_result_type create(key_type name)
+    {
+        if (auto id{ find(name) })
+        {
+            return { .iterator = m_pegs.begin() + static_cast<container_type::difference_type>(*id), .ok = false };
+        }
+        m_pegs.emplace_back(std::piecewise_construct, std::forward_as_tuple(name), std::forward_as_tuple());
+        return { .iterator = std::prev(m_pegs.end()), .ok = true };
+    }
+
+    create_result_type create(key_type name, tower_type&& tower)
+    {
+        auto&& result{ create(name) };
+        if (result.ok)
+        {
+            result.iterator->second = std::move(tower);
+            rehash();
+        }
+        return result;
+    }
+
+    // Builds the tower straight from disks, which must run from the largest to the smallest; the range is neither
+    // validated nor copied through an intermediate tower.
+    template<std::ranges::input_range R>
+    create_result_type create(key_type name, hanoi_sorted_t, R&& disks)
+    {
+        if (auto id{ find(name) })
+        {
+            return { .iterator = m_pegs.begin() + static_cast<container_type::difference_type>(*id), .ok = false };
+        }
+        m_pegs.emplace_back(std::piecewise_construct, std::forward_as_tuple(name),
+                            std::forward_as_tuple(hanoi_sorted, std::forward<R>(disks)));
+        auto id{ static_cast<id_type>(m_pegs.size() - 1) };
+        m_pegs.back().second.forEach([this, id](const auto& disk)
+                                     {
+                                         m_hash ^= zobrist(disk, id);
+                                     });
+        return { .iterator = std::prev(m_pegs.end()), .ok = true };
+    }
+
+    template<std::predicate<typename container_type::iterator> Initializer>
+    create_result_type create(key_type name, Initializer&& onSuccess)
+    {
+        auto&& result{ create(name) };
+        if (result.ok)
+        {
+            result.ok = onSuccess(result.iterator);
+            rehash();
+        }
+        return result;
+    }
+
+    mapped_type& select(key_type name)
+    {
+        return select(id(name));
+    }
+
+    const mapped_type& select(key_type name) const
+    {
+        return select(id(name));
+    }
+
+    mapped_type& select(id_type id)
+    {
+        return m_pegs[id].second;
+    }
+
+    const mapped_type& select(id_type id) const
+    {
+        return m_pegs[id].second;
+    }
+
+    bool move(key_type fromName, key_type toName)
+    {
+        return move(id(fromName), id(toName));
+    }
+
+    // A move naming an unknown peg, or from a peg to itself, is illegal.
+    bool move(id_type fromId, id_type toId)
+    {
+        if (!has(fromId) || !has(toId) || fromId == toId)
+        {
+            HanoiStats::increment(HanoiCounter::rejected_moves);
+            HanoiTrace::instant(HanoiEvent::rejected_move, fromId, toId);
+            return false;
+        }
+
+        auto& from{ select(fromId) };
+        auto& to{ select(toId) };
+        if (permits(fromId, toId) && from.transferTo(to))
+        {
+            m_hash ^= zobrist(to.top(), fromId) ^ zobrist(to.top(), toId);
+            HanoiStats::increment(HanoiCounter::moves);
+            HanoiTrace::instant(HanoiEvent::move, fromId, toId);
+            return true;
+        }
+
+        HanoiStats::increment(HanoiCounter::rejected_moves);
+        HanoiTrace::instant(HanoiEvent::rejected_move, fromId, toId);
+        return false;
+    }
+
+    apply_result_type apply(std::span<const HanoiMove> moves)
+    {
+        HanoiTraceSpan span{ HanoiEvent::apply, moves.size() };
+        auto count{ moves.size() };
+        for (std::size_t i{ 0 }; i < count; ++i)
+        {
+            if (!has(moves[i].from) || !has(moves[i].to))
+            {
+                count = i;
+                break;
+            }
+        }
+
+        auto* pegs{ m_pegs.data() };
+        for (std::size_t i{ 0 }; i < count; ++i)
+        {
+            const auto& [fromId, toId]{ moves[i] };
+            auto& from{ pegs[fromId].second };
+            auto& to{ pegs[toId].second };
+            if (fromId == toId || !permits(fromId, toId) || !from.transferTo(to))
+            {
+                HanoiStats::increment(HanoiCounter::moves, i);
+                HanoiStats::increment(HanoiCounter::rejected_moves);
+                HanoiTrace::instant(HanoiEvent::rejected_move, fromId, toId);
+                span.arguments(moves.size(), i);
+                return { .ok = false, .index = i };
+            }
+            m_hash ^= zobrist(to.top(), fromId) ^ zobrist(to.top(), toId);
+        }
+
+        HanoiStats::increment(HanoiCounter::moves, count);
+        span.arguments(moves.size(), count);
+        return { .ok = count == moves.size(), .index = count };
+    }
+
+    [[nodiscard]] std::uint64_t hash() const
+    {
+        return m_hash;
+    }
+
+    // Whether the rules let the top disk of fromId go onto toId, beyond the towers' own larger-below order. Rules
+    // without a connected() or stacks() check leave nothing to test, so the classic engine pays nothing per move.
+    [[nodiscard]] bool permits(id_type fromId, id_type toId) const
+    {
+        if constexpr (requires { { rules_type::connected(fromId, toId, size()) } -> std::convertible_to<bool>; })
+        {
+            if (!rules_type::connected(fromId, toId, size()))
+            {
+                return false;
+            }
+        }
+        if constexpr (requires(const tower_type::value_type& disk) { rules_type::stacks(disk, disk); })
+        {
+            const auto& from{ m_pegs[fromId].second };
+            const auto& to{ m_pegs[toId].second };
+            if (!from.empty() && !to.empty() && !rules_type::stacks(to.top(), from.top()))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // move() and apply() keep the hash current; call this after editing towers directly through select().
+    void rehash()
+    {
+        m_hash = 0;
+        for (id_type id{ 0 }; id < m_pegs.size(); ++id)
+        {
+            m_pegs[id].second.forEach([this, id](const auto& disk)
+                                      {
+                                          m_hash ^= zobrist(disk, id);
+                                      });
+        }
+    }
+
+    [[nodiscard]] static std::uint64_t zobrist(const typename tower_type::value_type& disk, id_type id)
+    {
+        if constexpr (requires { std::hash<typename tower_type::value_type>{}(disk); })
+        {
+            return hanoiMix(hanoiMix(std::hash<typename tower_type::value_type>{}(disk)) + id);
+        }
+        else
+        {
+            return 0;
+        }
+    }
+
+    template<typename T, typename A, typename R>
+    friend std::ostream& operator<<(std::ostream& os, const BasicTowerOfHanoi<T, A, R>& theTowerOfHanoi);
+
+private:
+    [[nodiscard]] std::optional<id_type> find(key_type name) const
+    {
+        for (id_type id{ 0 }; id < m_pegs.size(); ++id)
+        {
+            if (m_pegs[id].first == name)
+            {
+                return id;
+            }
+        }
+        return std::nullopt;
+    }
+
+private:
+    container_type m_pegs;
+    std::uint64_t m_hash{ 0 };
+};
+
+template<typename Tower, typename Allocator, typename Rules>
+std::ostream& operator<<(std::ostream& os, const BasicTowerOfHanoi<Tower, Allocator, Rules>& theTowerOfHanoi)
+{
+    for (auto&& [key, value]: theTowerOfHanoi.m_pegs)
+    {
+        os << key << '#' << value << '\n';
+    }
+    return os;
+}
+
+using TheTowerOfHanoi = BasicTowerOfHanoi<>;
+
+// Pegs, names and disks all draw from one memory_resource; vectors keep push/pop from churning the arena.
+using PmrTowerOfHanoi = BasicTowerOfHanoi<HanoiTower<std::uint_fast32_t, std::pmr::vector<std::uint_fast32_t>>,
+        std::pmr::polymorphic_allocator<std::byte>>;
+
+// Narrow disks in contiguous storage: one or two bytes per disk rather than a deque of std::uint_fast32_t.
+template<std::unsigned_integral Disk = std::uint16_t>
+using CompactTowerOfHanoi = BasicTowerOfHanoi<HanoiTower<Disk, std::vector<Disk>>>;
+
+class HanoiMoveView : public std::ranges::view_interface<HanoiMoveView>
+{
+public:
+    using size_type = std::uint_fast64_t;
+    using difference_type = std::int_fast64_t;
+    using peg_type = PegId;
+
+    static constexpr size_type max_disks{ 63 };
+
+    class iterator
+    {
+    public:
+        using iterator_concept = std::random_access_iterator_tag;
+        using iterator_category = std::input_iterator_tag;
+        using value_type = HanoiMove;
+        using difference_type = HanoiMoveView::difference_type;
+
+    public:
+        constexpr iterator() = default;
+
+        constexpr iterator(const std::array<peg_type, 3>& pegs, size_type index)
+                : m_pegs{ pegs }, m_index{ index }
+        {
+        }
+
+        [[nodiscard]] constexpr value_type operator*() const
+        {
+            return HanoiMoveView::move(m_pegs, m_index);
+        }
+
+        [[nodiscard]] constexpr value_type operator[](difference_type n) const
+        {
+            return HanoiMoveView::move(m_pegs, m_index + n);
+        }
+
+        [[nodiscard]] constexpr size_type index() const
+        {
+            return m_index;
+        }
+
+        constexpr iterator& operator++()
+        {
+            ++m_index;
+            return *this;
+        }
+
+        constexpr iterator operator++(int)
+        {
+            auto copy{ *this };
+            ++m_index;
+            return copy;
+        }
+
+        constexpr iterator& operator--()
+        {
+            --m_index;
+            return *this;
+        }
+
+        constexpr iterator operator--(int)
+        {
+            auto copy{ *this };
+            --m_index;
+            return copy;
+        }
+
+        constexpr iterator& operator+=(difference_type n)
+        {
+            m_index += n;
+            return *this;
+        }
+
+        constexpr iterator& operator-=(difference_type n)
+        {
+            m_index -= n;
+            return *this;
+        }
+
+        [[nodiscard]] friend constexpr iterator operator+(iterator it, difference_type n)
+        {
+            return it += n;
+        }
+
+        [[nodiscard]] friend constexpr iterator operator+(difference_type n, iterator it)
+        {
+            return it += n;
+        }
+
+        [[nodiscard]] friend constexpr iterator operator-(iterator it, difference_type n)
+        {
+            return it -= n;
+        }
+
+        [[nodiscard]] friend constexpr difference_type operator-(const iterator& lhs, const iterator& rhs)
+        {
+            return static_cast<difference_type>(lhs.m_index) - static_cast<difference_type>(rhs.m_index);
+        }
+
+        [[nodiscard]] friend constexpr bool operator==(const iterator& lhs, const iterator& rhs)
+        {
+            return lhs.m_index == rhs.m_index;
+        }
+
+        [[nodiscard]] friend constexpr auto operator<=>(const iterator& lhs, const iterator& rhs)
+        {
+            return lhs.m_index <=> rhs.m_index;
+        }
+
+    private:
+        std::array<peg_type, 3> m_pegs{};
+        size_type m_index{ 0 };
+    };
+
+public:
+    constexpr HanoiMoveView() = default;
+
+    // 2^64 - 1 moves would not fit the signed difference type, so more than max_disks disks is rejected.
+    constexpr explicit HanoiMoveView(size_type disks, peg_type source = 0, peg_type spare = 1, peg_type target = 2)
+            : m_disks{ checked(disks) },
+              m_pegs{ m_disks % 2 == 1
+                      ? std::array<peg_type, 3>{ source, spare, target }
+                      : std::array<peg_type, 3>{ source, target, spare } }
+    {
+    }
+
+    [[nodiscard]] constexpr size_type disks() const
+    {
+        return m_disks;
+    }
+
+    [[nodiscard]] constexpr size_type size() const
+    {
+        return (size_type{ 1 } << m_disks) - 1;
+    }
+
+    [[nodiscard]] constexpr iterator begin() const
+    {
+        return { m_pegs, 0 };
+    }
+
+    [[nodiscard]] constexpr iterator end() const
+    {
+        return { m_pegs, size() };
+    }
+
+    // Move k + 1 of the solution goes from peg (k & (k - 1)) % 3 to peg ((k | (k - 1)) + 1) % 3, ending on peg 2
+    // for odd disk counts; the peg table is permuted accordingly so the tower always lands on target.
+    [[nodiscard]] constexpr HanoiMove move(size_type index) const
+    {
+        return move(m_pegs, index);
+    }
+
+    [[nodiscard]] static constexpr size_type disk(size_type index)
+    {
+        return static_cast<size_type>(std::countr_zero(index + 1)) + 1;
+    }
+
+    // Where disk sits after the first count moves. It moves on every step whose trailing-zero count is disk - 1,
+    // cycling 0 -> 2 -> 1 through the unpermuted pegs when disk is odd and 0 -> 1 -> 2 when it is even.
+    [[nodiscard]] constexpr peg_type peg(size_type disk, size_type count) const
+    {
+        const auto moves{ (count + (size_type{ 1 } << (disk - 1))) >> disk };
+        return m_pegs[moves * (disk % 2 == 1 ? 2 : 1) % 3];
+    }
+
+private:
+    [[nodiscard]] static constexpr size_type checked(size_type disks)
+    {
+        if (disks > max_disks)
+        {
+            throw std::length_error{ "HanoiMoveView: too many disks" };
+        }
+        return disks;
+    }
+
+    [[nodiscard]] static constexpr HanoiMove move(const std::array<peg_type, 3>& pegs, size_type index)
+    {
+        const auto k{ index + 1 };
+        return { .from = pegs[(k & (k - 1)) % 3], .to = pegs[((k | (k - 1)) + 1) % 3] };
+    }
+
+private:
+    size_type m_disks{ 0 };
+    std::array<peg_type, 3> m_pegs{ 0, 2, 1 };
+};
+
+class TheTowerOfHanoiSolver
+{
+public:
+    using engine_type = TheTowerOfHanoi;
+    using key_type = engine_type::key_type;
+    using size_type = HanoiMoveView::size_type;
+
+    static constexpr size_type max_disks{ HanoiMoveView::max_disks };
+
+    [[nodiscard]] static constexpr size_type moveCount(size_type disks)
+    {
+        return HanoiMoveView{ disks }.size();
+    }
+
+    [[nodiscard]] static constexpr HanoiMoveView moves(size_type disks)
+    {
+        return HanoiMoveView{ disks };
+    }
+
+    template<std::invocable<key_type, key_type> Sink>
+    static bool solve(size_type disks, key_type source, key_type spare, key_type target, Sink&& sink)
+    {
+        if (disks > max_disks)
+        {
+            return false;
+        }
+
+        const std::array<key_type, 3> pegs{ source, spare, target };
+        for (auto&& [from, to]: moves(disks))
+        {
+            sink(pegs[from], pegs[to]);
+        }
+        return true;
+    }
+
+    template<typename Tower, typename Allocator>
+    static bool solve(BasicTowerOfHanoi<Tower, Allocator>& engine, size_type disks, key_type source, key_type spare,
+                      key_type target)
+    {
+        auto sourceId{ engine.resolve(source) };
+        auto spareId{ engine.resolve(spare) };
+        auto targetId{ engine.resolve(target) };
+        if (!sourceId || !spareId || !targetId)
+        {
+            return false;
+        }
+        return solve(engine, disks, *sourceId, *spareId, *targetId);
+    }
+
+    // Moves go through apply(), so the engine's counters and hash stay current. The pegs must be distinct, source
+    // must hold exactly disks 1 to disks and neither other peg a disk that small; otherwise nothing moves.
+    template<typename Tower, typename Allocator>
+    static bool solve(BasicTowerOfHanoi<Tower, Allocator>& engine, size_type disks, PegId source, PegId spare,
+                      PegId target)
+    {
+        if (disks > max_disks || !engine.has(source) || !engine.has(spare) || !engine.has(target) ||
+            source == spare || source == target || spare == target || !solvable(engine, disks, source, spare, target))
+        {
+            return false;
+        }
+
+        HanoiTraceSpan span{ HanoiEvent::solve, disks, moveCount(disks) };
+        const std::array<PegId, 3> pegs{ source, spare, target };
+        std::array<HanoiMove, solve_block_size> block{};
+        size_type size{ 0 };
+        for (auto&& [from, to]: moves(disks))
+        {
+            block[size++] = { pegs[from], pegs[to] };
+            if (size == block.size())
+            {
+                if (!engine.apply(block).ok)
+                {
+                    return false;
+                }
+                size = 0;
+            }
+        }
+        return engine.apply(std::span{ block }.first(size)).ok;
+    }
+
+private:
+    static constexpr size_type solve_block_size{ 1024 };
+
+    template<typename Tower, typename Allocator>
+    [[nodiscard]] static bool solvable(const BasicTowerOfHanoi<Tower, Allocator>& engine, size_type disks,
+                                       PegId source, PegId spare, PegId target)
+    {
+        // A tower's disks are distinct, so disks of them no larger than disks are exactly 1 to disks.
+        const auto& from{ engine.select(source) };
+        bool exact{ from.size() == disks };
+        from.forEach([&exact, disks](const auto& disk)
+                     {
+                         exact = exact && static_cast<size_type>(disk) <= disks;
+                     });
+        const auto clear{ [&engine, disks](PegId id)
+                          {
+                              const auto& tower{ engine.select(id) };
+                              return tower.empty() || static_cast<size_type>(tower.top()) > disks;
+                          } };
+        return exact && clear(spare) && clear(target);
+    }
+};
+
+template<>
+inline constexpr bool std::ranges::enable_borrowed_range<HanoiMoveView> = true;
+
+// Rule policies for BasicTowerOfHanoi. A policy may limit which pegs a move connects (connected) and which disk may
+// rest directly on which (stacks); each carries an iterative optimal solver for three pegs numbered 0, 1 and 2,
+// whose solve() hands every move to the sink and stops early once the sink returns false.
+//
+// The classic rules: any peg to any other, any smaller disk onto any larger one.
+struct HanoiClassicRules
+{
+    using size_type = HanoiMoveView::size_type;
+
+    static constexpr size_type max_disks{ HanoiMoveView::max_disks };
+
+    [[nodiscard]] static constexpr std::optional<size_type> moveCount(size_type disks, PegId source, PegId target)
+    {
+        if (disks > max_disks || source > 2 || target > 2)
+        {
+            return std::nullopt;
+        }
+        return source == target ? 0 : HanoiMoveView{ disks }.size();
+    }
+
+    template<std::predicate<PegId, PegId> Sink>
+    static constexpr bool solve(size_type disks, PegId source, PegId target, Sink&& sink)
+    {
+        if (!moveCount(disks, source, target))
+        {
+            return false;
+        }
+        if (source == target)
+        {
+            return true;
+        }
+
+        for (auto&& [from, to]: HanoiMoveView{ disks, source, 3 - source - target, target })
+        {
+            if (!sink(from, to))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+// Moves only go clockwise, from peg i to peg i + 1 and from the last peg back to the first.
+struct HanoiCyclicRules
+{
+    using size_type = std::uint_fast64_t;
+
+    static constexpr size_type max_disks{ 40 };
+
+    [[nodiscard]] static constexpr bool connected(PegId from, PegId to, std::size_t pegs)
+    {
+        return to == from + 1 || (to == 0 && from + 1 == pegs);
+    }
+
+    // Moving n disks one step clockwise takes one(n) = 2 two(n - 1) + 1 moves, two steps two(n) = 2 two(n - 1)
+    // + one(n - 1) + 2.
+    [[nodiscard]] static constexpr std::optional<size_type> moveCount(size_type disks, PegId source, PegId target)
+    {
+        if (disks > max_disks || source > 2 || target > 2)
+        {
+            return std::nullopt;
+        }
+
+        size_type one{ 0 };
+        size_type two{ 0 };
+        for (size_type disk{ 0 }; disk < disks; ++disk)
+        {
+            one = std::exchange(two, 2 * two + one + 2) * 2 + 1;
+        }
+        const auto steps{ (target + 3 - source) % 3 };
+        return steps == 0 ? 0 : steps == 1 ? one : two;
+    }
+
+    // Works through the recursive solution on an explicit stack of pending tasks, so no call depth or frame
+    // allocation grows with the number of disks.
+    template<std::predicate<PegId, PegId> Sink>
+    static constexpr bool solve(size_type disks, PegId source, PegId target, Sink&& sink)
+    {
+        const auto count{ moveCount(disks, source, target) };
+        if (!count || *count == 0)
+        {
+            return count.has_value();
+        }
+
+        enum class task_kind : std::uint8_t
+        {
+            move,
+            one,
+            two
+        };
+        struct task_type
+        {
+            task_kind kind{ task_kind::move };
+            size_type disks{ 0 };
+            PegId from{ 0 };
+        };
+
+        const auto next{ [](PegId peg) -> PegId { return peg == 2 ? 0 : peg + 1; } };
+        std::array<task_type, 4 * max_disks + 1> tasks{};
+        std::size_t depth{ 0 };
+        tasks[depth++] = { .kind = next(source) == target ? task_kind::one : task_kind::two, .disks = disks,
+                           .from = source };
+        const auto push{ [&tasks, &depth](const task_type& task)
+                         {
+                             if (task.kind == task_kind::move || task.disks > 0)
+                             {
+                                 tasks[depth++] = task;
+                             }
+                         } };
+        while (depth > 0)
+        {
+            const auto [kind, n, from]{ tasks[--depth] };
+            const auto over{ next(next(from)) };
+            switch (kind)
+            {
+                case task_kind::move:
+                    if (!sink(from, next(from)))
+                    {
+                        return false;
+                    }
+                    break;
+                case task_kind::one:
+                    push({ task_kind::two, n - 1, over });
+                    push({ task_kind::move, n, from });
+                    push({ task_kind::two, n - 1, from });
+                    break;
+                case task_kind::two:
+                    push({ task_kind::two, n - 1, from });
+                    push({ task_kind::move, n, next(from) });
+                    push({ task_kind::one, n - 1, over });
+                    push({ task_kind::move, n, from });
+                    push({ task_kind::two, n - 1, from });
+                    break;
+            }
+        }
+        return true;
+    }
+};
+
+// Pegs stand in a row and moves only go between neighbours. On three pegs, end to end takes 3^n - 1 moves and
+// passes through every position; an end to the middle or back takes half that.
+struct HanoiAdjacentRules
+{
+    using size_type = std::uint_fast64_t;
+
+    static constexpr size_type max_disks{ 40 };
+
+    [[nodiscard]] static constexpr bool connected(PegId from, PegId to, std::size_t)
+    {
+        return to == from + 1 || from == to + 1;
+    }
+
+    [[nodiscard]] static constexpr std::optional<size_type> moveCount(size_type disks, PegId source, PegId target)
+    {
+        if (disks > max_disks || source > 2 || target > 2)
+        {
+            return std::nullopt;
+        }
+
+        size_type power{ 1 };
+        for (size_type disk{ 0 }; disk < disks; ++disk)
+        {
+            power *= 3;
+        }
+        return source == target ? 0 : source + target == 2 ? power - 1 : (power - 1) / 2;
+    }
+
+    // The same explicit-stack walk as the cyclic solver, over end-to-end, into-the-middle and out-of-the-middle
+    // tasks.
+    template<std::predicate<PegId, PegId> Sink>
+    static constexpr bool solve(size_type disks, PegId source, PegId target, Sink&& sink)
+    {
+        const auto count{ moveCount(disks, source, target) };
+        if (!count || *count == 0)
+        {
+            return count.has_value();
+        }
+
+        enum class task_kind : std::uint8_t
+        {
+            move,
+            across,
+            in,
+            out
+        };
+        struct task_type
+        {
+            task_kind kind{ task_kind::move };
+            size_type disks{ 0 };
+            PegId from{ 0 };
+            PegId to{ 0 };
+        };
+
+        constexpr PegId middle{ 1 };
+        std::array<task_type, 4 * max_disks + 1> tasks{};
+        std::size_t depth{ 0 };
+        tasks[depth++] = { .kind = source == middle ? task_kind::out : target == middle ? task_kind::in
+                                                                                        : task_kind::across,
+                           .disks = disks, .from = source, .to = target };
+        const auto push{ [&tasks, &depth](const task_type& task)
+                         {
+                             if (task.kind == task_kind::move || task.disks > 0)
+                             {
+                                 tasks[depth++] = task;
+                             }
+                         } };
+        while (depth > 0)
+        {
+            const auto [kind, n, from, to]{ tasks[--depth] };
+            switch (kind)
+            {
+                case task_kind::move:
+                    if (!sink(from, to))
+                    {
+                        return false;
+                    }
+                    break;
+                case task_kind::across:
+                    push({ task_kind::across, n - 1, from, to });
+                    push({ task_kind::move, n, middle, to });
+                    push({ task_kind::across, n - 1, to, from });
+                    push({ task_kind::move, n, from, middle });
+                    push({ task_kind::across, n - 1, from, to });
+                    break;
+                case task_kind::in:
+                    push({ task_kind::in, n - 1, 2 - from, middle });
+                    push({ task_kind::move, n, from, middle });
+                    push({ task_kind::across, n - 1, from, 2 - from });
+                    break;
+                case task_kind::out:
+                    push({ task_kind::across, n - 1, 2 - to, to });
+                    push({ task_kind::move, n, middle, to });
+                    push({ task_kind::out, n - 1, middle, 2 - to });
+                    break;
+            }
+        }
+        return true;
+    }
+};
+
+// Plays the optimal solution of an engine's own rules through engine.move(), so every move is still checked.
+class HanoiRuleSolver
+{
+public:
+    using size_type = std::uint_fast64_t;
+
+    template<typename Tower, typename Allocator, typename Rules>
+    [[nodiscard]] static std::optional<size_type> moveCount(const BasicTowerOfHanoi<Tower, Allocator, Rules>& engine,
+                                                            size_type disks, PegId source, PegId target)
+    {
+        return engine.size() == 3 ? Rules::moveCount(disks, source, target) : std::nullopt;
+    }
+
+    // Fails without moving anything unless source holds exactly disks 1 to disks and the other pegs are empty.
+    template<typename Tower, typename Allocator, typename Rules>
+    static bool solve(BasicTowerOfHanoi<Tower, Allocator, Rules>& engine, size_type disks, PegId source, PegId target)
+    {
+        const auto count{ moveCount(engine, disks, source, target) };
+        if (!count || !stacked(engine, disks, source))
+        {
+            return false;
+        }
+        HanoiTraceSpan span{ HanoiEvent::solve, disks, *count };
+        return Rules::solve(disks, source, target, [&engine](PegId from, PegId to)
+        {
+            return engine.move(from, to);
+        });
+    }
+
+private:
+    template<typename Tower, typename Allocator, typename Rules>
+    [[nodiscard]] static bool stacked(const BasicTowerOfHanoi<Tower, Allocator, Rules>& engine, size_type disks,
+                                      PegId source)
+    {
+        // A tower's disks are distinct, so disks of them no larger than disks are exactly 1 to disks.
+        bool exact{ engine.select(source).size() == disks };
+        engine.select(source).forEach([&exact, disks](const auto& disk)
+                                      {
+                                          exact = exact && static_cast<size_type>(disk) <= disks;
+                                      });
+        for (PegId id{ 0 }; exact && id < engine.size(); ++id)
+        {
+            exact = id == source || engine.select(id).empty();
+        }
+        return exact;
+    }
+};
+
+using CyclicTowerOfHanoi = BasicTowerOfHanoi<HanoiTower<std::uint_fast32_t>, std::allocator<std::byte>,
+        HanoiCyclicRules>;
+using AdjacentTowerOfHanoi = BasicTowerOfHanoi<HanoiTower<std::uint_fast32_t>, std::allocator<std::byte>,
+        HanoiAdjacentRules>;
+
+// The optimal three-peg solution as a flat table, built at compile time for disk counts small enough to embed.
+template<std::size_t Disks> requires (Disks <= 12)
+inline constexpr auto hanoi_move_table{ []
+                                        {
+                                            std::array<HanoiMove, (std::size_t{ 1 } << Disks) - 1> table{};
+                                            std::ranges::copy(HanoiMoveView{ Disks }, table.begin());
+                                            return table;
+                                        }() };
+
+// An engine whose peg and disk counts are template parameters. Pegs are bitboards in a fixed array addressed
+// by index only, so there is no name lookup, no allocation and no indirection on the move path, and every
+// operation is usable in constant expressions. Disks start on peg 0; the puzzle is solved once they are all
+// on the last peg.
+template<std::size_t Pegs, std::size_t Disks>
+    requires (Pegs >= 3 && Disks <= std::numeric_limits<std::uint64_t>::digits)
+class FixedTowerOfHanoi
+{
+public:
+    using word_type = std::conditional_t<Disks <= 8, std::uint8_t,
+            std::conditional_t<Disks <= 16, std::uint16_t,
+                    std::conditional_t<Disks <= 32, std::uint32_t, std::uint64_t>>>;
+    using tower_type = HanoiTower<std::uint_fast32_t, HanoiBitboard<word_type>>;
+    using container_type = std::array<tower_type, Pegs>;
+    using id_type = PegId;
+    using size_type = std::size_t;
+    using apply_result_type = TheTowerOfHanoi::apply_result_type;
+
+    static constexpr size_type peg_count{ Pegs };
+    static constexpr size_type disk_count{ Disks };
+    static constexpr id_type source{ 0 };
+    static constexpr id_type target{ Pegs - 1 };
+
+public:
+    constexpr FixedTowerOfHanoi()
+            : m_pegs{}
+    {
+        m_pegs[source] = tower_type{ HanoiBitboard<word_type>{ full_word }};
+    }
+
+    [[nodiscard]] static constexpr bool has(id_type id)
+    {
+        return id < Pegs;
+    }
+
+    [[nodiscard]] static constexpr size_type size()
+    {
+        return Pegs;
+    }
+
+    [[nodiscard]] constexpr const tower_type& select(id_type id) const
+    {
+        return m_pegs[id];
+    }
+
+    [[nodiscard]] constexpr bool solved() const
+    {
+        return m_pegs[target].size() == Disks;
+    }
+
+    constexpr bool move(id_type fromId, id_type toId)
+    {
+        if (has(fromId) && has(toId) && fromId != toId && m_pegs[fromId].transferTo(m_pegs[toId]))
+        {
+            if !consteval
+            {
+                HanoiStats::increment(HanoiCounter::moves);
+            }
+            return true;
+        }
+
+        if !consteval
+        {
+            HanoiStats::increment(HanoiCounter::rejected_moves);
+        }
+        return false;
+    }
+
+    constexpr apply_result_type apply(std::span<const HanoiMove> moves)
+    {
+        for (std::size_t i{ 0 }; i < moves.size(); ++i)
+        {
+            const auto [fromId, toId]{ moves[i] };
+            if (!has(fromId) || !has(toId) || fromId == toId || !m_pegs[fromId].transferTo(m_pegs[toId]))
+            {
+                if !consteval
+                {
+                    HanoiStats::increment(HanoiCounter::moves, i);
+                    HanoiStats::increment(HanoiCounter::rejected_moves);
+                }
+                return { .ok = false, .index = i };
+            }
+        }
+
+        if !consteval
+        {
+            HanoiStats::increment(HanoiCounter::moves, moves.size());
+        }
+        return { .ok = true, .index = moves.size() };
+    }
+
+    // Plays the optimal solution from the starting layout; small puzzles replay the precomputed table. Any other
+    // position would fail partway, so it is refused before a move is played.
+    constexpr bool solve() requires (Pegs == 3)
+    {
+        if (*this != FixedTowerOfHanoi{})
+        {
+            return false;
+        }
+        if constexpr (requires { hanoi_move_table<Disks>; })
+        {
+            return apply(hanoi_move_table<Disks>).ok;
+        }
+        else
+        {
+            for (auto&& [fromId, toId]: HanoiMoveView{ Disks })
+            {
+                if (!m_pegs[fromId].transferTo(m_pegs[toId]))
+                {
+                    return false;
+                }
+            }
+            if !consteval
+            {
+                HanoiStats::increment(HanoiCounter::moves, HanoiMoveView{ Disks }.size());
+            }
+            return true;
+        }
+    }
+
+    friend constexpr bool operator==(const FixedTowerOfHanoi& lhs, const FixedTowerOfHanoi& rhs)
+    {
+        return std::ranges::equal(lhs.m_pegs, rhs.m_pegs, {}, &tower_type::adapter, &tower_type::adapter);
+    }
+
+    friend std::ostream& operator<<(std::ostream& os, const FixedTowerOfHanoi& theTowerOfHanoi)
+    {
+        for (id_type id{ 0 }; id < Pegs; ++id)
+        {
+            os << id << '#' << theTowerOfHanoi.m_pegs[id] << '\n';
+        }
+        return os;
+    }
+
+private:
+    static constexpr word_type full_word{ Disks == std::numeric_limits<word_type>::digits
+                                          ? std::numeric_limits<word_type>::max()
+                                          : static_cast<word_type>((word_type{ 1 } << Disks) - 1) };
+
+private:
+    container_type m_pegs;
+};
+
+class HanoiThreadPool
+{
+public:
+    using task_type = std::function<void()>;
+    using size_type = std::size_t;
+
+public:
+    explicit HanoiThreadPool(size_type threads = std::max(std::thread::hardware_concurrency(), 1u))
+            : m_queues{ std::make_unique<queue_type[]>(std::max<size_type>(threads, 1)) },
+              m_queueCount{ std::max<size_type>(threads, 1) },
+              m_threads{}
+    {
+        m_threads.reserve(m_queueCount);
+        for (size_type index{ 0 }; index < m_queueCount; ++index)
+        {
+            m_threads.emplace_back([this, index](std::stop_token token)
+                                   {
+                                       work(index, token);
+                                   });
+        }
+    }
+
+    HanoiThreadPool(const HanoiThreadPool&) = delete;
+    HanoiThreadPool& operator=(const HanoiThreadPool&) = delete;
+
+    ~HanoiThreadPool()
+    {
+        for (auto& thread: m_threads)
+        {
+            thread.request_stop();
+        }
+        m_wake.notify_all();
+    }
+
+    [[nodiscard]] size_type size() const
+    {
+        return m_queueCount;
+    }
+
+    // The task is counted before it becomes visible, so a worker that takes it at once can never bring the counters
+    // below zero; holding m_sleepMutex until it is queued keeps sleepers from waking to find it missing.
+    void submit(task_type task)
+    {
+        auto& queue{ m_queues[m_next.fetch_add(1, std::memory_order_relaxed) % m_queueCount] };
+        m_pending.fetch_add(1, std::memory_order_relaxed);
+        {
+            std::scoped_lock lock{ m_sleepMutex };
+            m_queued.fetch_add(1, std::memory_order_release);
+            std::scoped_lock queueLock{ queue.mutex };
+            queue.tasks.push_back(std::move(task));
+        }
+        m_wake.notify_one();
+    }
+
+    void wait()
+    {
+        task_type task{};
+        while (m_pending.load(std::memory_order_acquire) > 0)
+        {
+            if (acquire(0, task))
+            {
+                run(task);
+                continue;
+            }
+
+            std::unique_lock lock{ m_sleepMutex };
+            m_idle.wait(lock, [this]
+            {
+                return m_pending.load(std::memory_order_acquire) == 0
+                       || m_queued.load(std::memory_order_acquire) > 0;
+            });
+        }
+    }
+
+private:
+    struct queue_type
+    {
+        std::mutex mutex;
+        std::deque<task_type> tasks;
+    };
+
+    bool acquire(size_type index, task_type& task)
+    {
+        for (size_type offset{ 0 }; offset < m_queueCount; ++offset)
+        {
+            auto& queue{ m_queues[(index + offset) % m_queueCount] };
+            std::scoped_lock lock{ queue.mutex };
+            if (queue.tasks.empty())
+            {
+                continue;
+            }
+
+            if (offset == 0)
+            {
+                task = std::move(queue.tasks.back());
+                queue.tasks.pop_back();
+            }
+            else
+            {
+                task = std::move(queue.tasks.front());
+                queue.tasks.pop_front();
+            }
+            m_queued.fetch_sub(1, std::memory_order_acq_rel);
+            return true;
+        }
+        return false;
+    }
+
+    void run(task_type& task)
+    {
+        task();
+        task = nullptr;
+        if (m_pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            std::scoped_lock lock{ m_sleepMutex };
+            m_idle.notify_all();
+        }
+    }
+
+    void work(size_type index, std::stop_token token)
+    {
+        task_type task{};
+        while (!token.stop_requested())
+        {
+            if (acquire(index, task))
+            {
+                run(task);
+                continue;
+            }
+
+            std::unique_lock lock{ m_sleepMutex };
+            m_wake.wait(lock, token, [this]
+            {
+                return m_queued.load(std::memory_order_acquire) > 0;
+            });
+        }
+    }
+
+private:
+    std::unique_ptr<queue_type[]> m_queues;
+    size_type m_queueCount;
+    std::atomic<size_type> m_next{ 0 };
+    std::atomic<size_type> m_pending{ 0 };
+    std::atomic<size_type> m_queued{ 0 };
+    std::mutex m_sleepMutex{};
+    std::condition_variable_any m_wake{};
+    std::condition_variable_any m_idle{};
+    std::vector<std::jthread> m_threads;
+};
+
+class FrameStewartSolver
+{
+public:
+    using size_type = std::uint_fast64_t;
+    using table_type = std::vector<std::vector<size_type>>;
+    struct task_type
+    {
+        std::size_t disks;
+        PegId source;
+        PegId spare;
+        PegId target;
+        size_type offset;
+    };
+
+    static constexpr std::size_t min_pegs{ 3 };
+    static constexpr size_type unsolvable{ std::numeric_limits<size_type>::max() };
+    static constexpr size_type chunk_size{ size_type{ 1 } << 16 };
+
+public:
+    FrameStewartSolver(std::size_t maxDisks, std::size_t maxPegs)
+            : m_maxDisks{ maxDisks },
+              m_costs(std::max(maxPegs, min_pegs) + 1, std::vector<size_type>(maxDisks + 1, unsolvable)),
+              m_splits(std::max(maxPegs, min_pegs) + 1, std::vector<size_type>(maxDisks + 1, 0))
+    {
+        for (std::size_t disks{ 0 }; disks <= m_maxDisks; ++disks)
+        {
+            m_costs[min_pegs][disks] = disks <= HanoiMoveView::max_disks ? HanoiMoveView{ disks }.size() : unsolvable;
+        }
+
+        for (auto pegs{ min_pegs + 1 }; pegs < m_costs.size(); ++pegs)
+        {
+            m_costs[pegs][0] = 0;
+            for (std::size_t disks{ 1 }; disks <= m_maxDisks; ++disks)
+            {
+                if (disks == 1)
+                {
+                    m_costs[pegs][disks] = 1;
+                    continue;
+                }
+
+                for (std::size_t top{ 1 }; top < disks; ++top)
+                {
+                    auto aside{ m_costs[pegs][top] };
+                    auto bottom{ m_costs[pegs - 1][disks - top] };
+                    if (aside > (unsolvable - bottom) / 2)
+                    {
+                        continue;
+                    }
+
+                    if (auto cost{ 2 * aside + bottom }; cost < m_costs[pegs][disks])
+                    {
+                        m_costs[pegs][disks] = cost;
+                        m_splits[pegs][disks] = top;
+                    }
+                }
+            }
+        }
+    }
+
+    [[nodiscard]] size_type moveCount(std::size_t disks, std::size_t pegs) const
+    {
+        if (disks > m_maxDisks || pegs < min_pegs || pegs >= m_costs.size())
+        {
+            return unsolvable;
+        }
+        return m_costs[pegs][disks];
+    }
+
+    [[nodiscard]] size_type split(std::size_t disks, std::size_t pegs) const
+    {
+        return m_splits[pegs][disks];
+    }
+
+    // Decomposes the transfer from pegs.front() to pegs.back() into independent three-peg transfers, each writing
+    // its moves at a precomputed offset of the full solution. The pegs must be distinct.
+    [[nodiscard]] std::vector<task_type> plan(std::size_t disks, std::span<const PegId> pegs) const
+    {
+        std::vector<task_type> tasks{};
+        if (!solvable(disks, pegs))
+        {
+            return tasks;
+        }
+
+        struct frame_type
+        {
+            std::size_t disks;
+            std::vector<PegId> available;
+            PegId source;
+            PegId target;
+            size_type offset;
+        };
+
+        std::vector<frame_type> frames{};
+        frames.push_back({ .disks = disks,
+                           .available = { pegs.begin(), pegs.end() },
+                           .source = pegs.front(),
+                           .target = pegs.back(),
+                           .offset = 0 });
+        while (!frames.empty())
+        {
+            auto frame{ std::move(frames.back()) };
+            frames.pop_back();
+            if (frame.disks == 0)
+            {
+                continue;
+            }
+
+            auto intermediate{ *std::ranges::find_if(frame.available, [&frame](PegId id)
+            {
+                return id != frame.source && id != frame.target;
+            }) };
+
+            const auto pegCount{ frame.available.size() };
+            if (pegCount == min_pegs || frame.disks == 1)
+            {
+                tasks.push_back({ .disks = frame.disks,
+                                  .source = frame.source,
+                                  .spare = intermediate,
+                                  .target = frame.target,
+                                  .offset = frame.offset });
+                continue;
+            }
+
+            const auto top{ split(frame.disks, pegCount) };
+            const auto aside{ m_costs[pegCount][top] };
+            const auto bottom{ m_costs[pegCount - 1][frame.disks - top] };
+
+            auto remaining{ frame.available };
+            std::erase(remaining, intermediate);
+
+            frames.push_back({ .disks = top,
+                               .available = frame.available,
+                               .source = intermediate,
+                               .target = frame.target,
+                               .offset = frame.offset + aside + bottom });
+            frames.push_back({ .disks = frame.disks - top,
+                               .available = std::move(remaining),
+                               .source = frame.source,
+                               .target = frame.target,
+                               .offset = frame.offset + aside });
+            frames.push_back({ .disks = top,
+                               .available = std::move(frame.available),
+                               .source = frame.source,
+                               .target = intermediate,
+                               .offset = frame.offset });
+        }
+
+        std::ranges::sort(tasks, {}, &task_type::offset);
+        return tasks;
+    }
+
+    static void emit(const task_type& task, size_type begin, size_type end, std::span<HanoiMove> moves)
+    {
+        const HanoiMoveView view{ task.disks, task.source, task.spare, task.target };
+        for (auto index{ begin }; index < end; ++index)
+        {
+            moves[task.offset + index] = view.move(index);
+        }
+    }
+
+    [[nodiscard]] std::optional<std::vector<HanoiMove>> generate(std::size_t disks, std::span<const PegId> pegs,
+                                                                 HanoiThreadPool& pool) const
+    {
+        if (!solvable(disks, pegs))
+        {
+            return std::nullopt;
+        }
+
+        std::vector<HanoiMove> moves(moveCount(disks, pegs.size()));
+        for (auto&& task: plan(disks, pegs))
+        {
+            const auto size{ HanoiMoveView{ task.disks }.size() };
+            for (size_type begin{ 0 }; begin < size; begin += chunk_size)
+            {
+                pool.submit([task, begin, end = std::min(size, begin + chunk_size), out = std::span{ moves }]
+                            {
+                                emit(task, begin, end, out);
+                            });
+            }
+        }
+        pool.wait();
+        return moves;
+    }
+
+    template<typename Tower, typename Allocator>
+    bool solve(BasicTowerOfHanoi<Tower, Allocator>& engine, std::size_t disks, std::span<const PegId> pegs,
+               HanoiThreadPool& pool) const
+    {
+        auto moves{ generate(disks, pegs, pool) };
+        return moves && engine.apply(*moves).ok;
+    }
+
+private:
+    [[nodiscard]] bool solvable(std::size_t disks, std::span<const PegId> pegs) const
+    {
+        if (moveCount(disks, pegs.size()) == unsolvable)
+        {
+            return false;
+        }
+        std::vector<PegId> sorted{ pegs.begin(), pegs.end() };
+        std::ranges::sort(sorted);
+        return std::ranges::adjacent_find(sorted) == sorted.end();
+    }
+
+private:
+    std::size_t m_maxDisks;
+    table_type m_costs;
+    table_type m_splits;
+};
+
+class HanoiStateCodec
+{
+public:
+    using code_type = std::uint64_t;
+    using size_type = std::size_t;
+
+public:
+    HanoiStateCodec(size_type pegs, size_type disks)
+            : m_pegs{ pegs }, m_disks{ disks }, m_powers(disks + 1, 1)
+    {
+        for (size_type disk{ 1 }; disk <= m_disks; ++disk)
+        {
+            m_powers[disk] = m_powers[disk - 1] * m_pegs;
+        }
+    }
+
+    // Every state is a base-pegs number whose (disk - 1)-th digit is the peg holding that disk.
+    [[nodiscard]] static bool representable(size_type pegs, size_type disks)
+    {
+        if (pegs < 2)
+        {
+            return false;
+        }
+        code_type states{ 1 };
+        for (size_type disk{ 0 }; disk < disks; ++disk)
+        {
+            if (states > std::numeric_limits<code_type>::max() / pegs)
+            {
+                return false;
+            }
+            states *= pegs;
+        }
+        return true;
+    }
+
+    [[nodiscard]] size_type pegs() const
+    {
+        return m_pegs;
+    }
+
+    [[nodiscard]] size_type disks() const
+    {
+        return m_disks;
+    }
+
+    [[nodiscard]] code_type stateCount() const
+    {
+        return m_powers[m_disks];
+    }
+
+    [[nodiscard]] PegId peg(code_type code, size_type disk) const
+    {
+        return static_cast<PegId>(code / m_powers[disk - 1] % m_pegs);
+    }
+
+    [[nodiscard]] code_type uniform(PegId peg) const
+    {
+        return (m_powers[m_disks] - 1) / (m_pegs - 1) * peg;
+    }
+
+    [[nodiscard]] code_type encode(std::span<const PegId> pegOfDisk) const
+    {
+        code_type code{ 0 };
+        for (size_type disk{ m_disks }; disk > 0; --disk)
+        {
+            code = code * m_pegs + pegOfDisk[disk - 1];
+        }
+        return code;
+    }
+
+    template<typename Tower, typename Allocator, typename Rules>
+    [[nodiscard]] std::optional<code_type> encode(const BasicTowerOfHanoi<Tower, Allocator, Rules>& engine) const
+    {
+        if (engine.size() != m_pegs)
+        {
+            return std::nullopt;
+        }
+
+        auto pegOfDisk{ assignment(engine, m_disks) };
+        if (!pegOfDisk)
+        {
+            return std::nullopt;
+        }
+        return encode(*pegOfDisk);
+    }
+
+    // The peg holding each of the disks 1..disks, provided those are exactly the disks in the engine.
+    template<typename Tower, typename Allocator, typename Rules>
+    [[nodiscard]] static std::optional<std::vector<PegId>>
+    assignment(const BasicTowerOfHanoi<Tower, Allocator, Rules>& engine, size_type disks)
+    {
+        const auto unassigned{ engine.size() };
+        std::vector<PegId> pegOfDisk(disks, unassigned);
+        bool ok{ true };
+        for (PegId id{ 0 }; id < engine.size(); ++id)
+        {
+            engine.select(id).forEach([&](const auto& disk)
+                                      {
+                                          const auto index{ static_cast<size_type>(disk) - 1 };
+                                          if (index >= disks || pegOfDisk[index] != unassigned)
+                                          {
+                                              ok = false;
+                                              return;
+                                          }
+                                          pegOfDisk[index] = id;
+                                      });
+        }
+
+        if (!ok || std::ranges::count(pegOfDisk, unassigned) != 0)
+        {
+            return std::nullopt;
+        }
+        return pegOfDisk;
+    }
+
+    template<typename Tower, typename Allocator, typename Rules>
+    [[nodiscard]] static std::optional<std::vector<PegId>>
+    assignment(const BasicTowerOfHanoi<Tower, Allocator, Rules>& engine)
+    {
+        size_type disks{ 0 };
+        for (PegId id{ 0 }; id < engine.size(); ++id)
+        {
+            disks += engine.select(id).size();
+        }
+        return assignment(engine, disks);
+    }
+
+    // Smallest disk on each peg, or 0 for an empty peg.
+    void tops(code_type code, std::span<size_type> result) const
+    {
+        std::ranges::fill(result, 0);
+        for (size_type disk{ 1 }; disk <= m_disks; ++disk, code /= m_pegs)
+        {
+            if (auto& top{ result[code % m_pegs] }; top == 0)
+            {
+                top = disk;
+            }
+        }
+    }
+
+    [[nodiscard]] code_type move(code_type code, size_type disk, PegId from, PegId to) const
+    {
+        return code - from * m_powers[disk - 1] + to * m_powers[disk - 1];
+    }
+
+    [[nodiscard]] HanoiMove difference(code_type before, code_type after) const
+    {
+        for (size_type disk{ 1 }; disk <= m_disks; ++disk, before /= m_pegs, after /= m_pegs)
+        {
+            if (before % m_pegs != after % m_pegs)
+            {
+                return { .from = static_cast<PegId>(before % m_pegs), .to = static_cast<PegId>(after % m_pegs) };
+            }
+        }
+        return { .from = 0, .to = 0 };
+    }
+
+private:
+    size_type m_pegs;
+    size_type m_disks;
+    std::vector<code_type> m_powers;
+};
+
+class HanoiTranspositionTable
+{
+public:
+    using key_type = std::uint64_t;
+    using value_type = std::uint64_t;
+    using size_type = std::size_t;
+
+    static constexpr size_type max_probes{ 64 };
+
+public:
+    explicit HanoiTranspositionTable(size_type capacity)
+            : m_mask{ std::bit_ceil(std::max<size_type>(capacity, 2)) - 1 },
+              m_slots{ std::make_unique<slot_type[]>(m_mask + 1) }
+    {
+    }
+
+    [[nodiscard]] size_type capacity() const
+    {
+        return m_mask + 1;
+    }
+
+    // Returns true if key was newly inserted. Value becomes visible to find() once every concurrent insert has
+    // been synchronized with the reader (e.g. by joining the writers).
+    bool insert(key_type key, value_type value)
+    {
+        const auto stored{ key + 1 };
+        for (size_type probe{ 0 }, index{ hanoiMix(key) & m_mask }; probe < max_probes;
+             ++probe, index = (index + 1) & m_mask)
+        {
+            auto& slot{ m_slots[index] };
+            auto expected{ slot.key.load(std::memory_order_relaxed) };
+            if (expected == 0 && slot.key.compare_exchange_strong(expected, stored, std::memory_order_acq_rel))
+            {
+                slot.value.store(value, std::memory_order_release);
+                return true;
+            }
+            if (expected == stored)
+            {
+                return false;
+            }
+        }
+        m_overflowed.store(true, std::memory_order_relaxed);
+        return false;
+    }
+
+    [[nodiscard]] std::optional<value_type> find(key_type key) const
+    {
+        const auto stored{ key + 1 };
+        for (size_type probe{ 0 }, index{ hanoiMix(key) & m_mask }; probe < max_probes;
+             ++probe, index = (index + 1) & m_mask)
+        {
+            const auto& slot{ m_slots[index] };
+            const auto current{ slot.key.load(std::memory_order_acquire) };
+            if (current == stored)
+            {
+                return slot.value.load(std::memory_order_acquire);
+            }
+            if (current == 0)
+            {
+                return std::nullopt;
+            }
+        }
+        return std::nullopt;
+    }
+
+    [[nodiscard]] bool overflowed() const
+    {
+        return m_overflowed.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct slot_type
+    {
+        std::atomic<key_type> key{ 0 };
+        std::atomic<value_type> value{ 0 };
+    };
+
+private:
+    size_type m_mask;
+    std::unique_ptr<slot_type[]> m_slots;
+    std::atomic<bool> m_overflowed{ false };
+};
+
+class HanoiSearch
+{
+public:
+    using code_type = HanoiStateCodec::code_type;
+    using size_type = std::size_t;
+
+    static constexpr size_type chunk_size{ 4096 };
+    static constexpr size_type max_table_capacity{ size_type{ 1 } << 26 };
+
+public:
+    // Level-synchronous parallel BFS; every state is recorded in the transposition table with its parent.
+    [[nodiscard]] static std::optional<std::vector<HanoiMove>> shortestPath(const HanoiStateCodec& codec,
+                                                                            code_type start, code_type goal,
+                                                                            HanoiThreadPool& pool)
+    {
+        const auto states{ codec.stateCount() };
+        HanoiTranspositionTable table{
+                static_cast<size_type>(std::min<code_type>(states * 2, max_table_capacity)) };
+        table.insert(start, start);
+
+        std::vector<code_type> frontier{ start };
+        std::atomic<bool> found{ start == goal };
+        while (!found.load(std::memory_order_relaxed) && !frontier.empty())
+        {
+            const auto chunks{ (frontier.size() + chunk_size - 1) / chunk_size };
+            std::vector<std::vector<code_type>> next(chunks);
+            for (size_type chunk{ 0 }; chunk < chunks; ++chunk)
+            {
+                pool.submit([&, chunk]
+                            {
+                                expand(codec, table, std::span{ frontier }.subspan(
+                                        chunk * chunk_size,
+                                        std::min(chunk_size, frontier.size() - chunk * chunk_size)), goal,
+                                       next[chunk], found);
+                            });
+            }
+            pool.wait();
+
+            if (table.overflowed())
+            {
+                return std::nullopt;
+            }
+
+            frontier.clear();
+            for (auto&& states: next)
+            {
+                frontier.insert(frontier.end(), states.begin(), states.end());
+            }
+        }
+
+        if (!found.load(std::memory_order_relaxed))
+        {
+            return std::nullopt;
+        }
+
+        std::vector<HanoiMove> path{};
+        for (auto current{ goal }; current != start;)
+        {
+            const auto parent{ *table.find(current) };
+            path.push_back(codec.difference(parent, current));
+            current = parent;
+        }
+        std::ranges::reverse(path);
+        return path;
+    }
+
+    template<typename Tower, typename Allocator>
+    static bool solve(BasicTowerOfHanoi<Tower, Allocator>& engine, size_type disks, PegId target, HanoiThreadPool& pool)
+    {
+        if (!HanoiStateCodec::representable(engine.size(), disks) || !engine.has(target))
+        {
+            return false;
+        }
+
+        const HanoiStateCodec codec{ engine.size(), disks };
+        auto start{ codec.encode(engine) };
+        if (!start)
+        {
+            return false;
+        }
+
+        auto path{ shortestPath(codec, *start, codec.uniform(target), pool) };
+        return path && engine.apply(*path).ok;
+    }
+
+private:
+    static void expand(const HanoiStateCodec& codec, HanoiTranspositionTable& table, std::span<const code_type> states,
+                       code_type goal, std::vector<code_type>& next, std::atomic<bool>& found)
+    {
+        std::vector<size_type> tops(codec.pegs());
+        for (auto state: states)
+        {
+            codec.tops(state, tops);
+            for (PegId from{ 0 }; from < codec.pegs(); ++from)
+            {
+                if (tops[from] == 0)
+                {
+                    continue;
+                }
+
+                for (PegId to{ 0 }; to < codec.pegs(); ++to)
+                {
+                    if (to == from || (tops[to] != 0 && tops[to] < tops[from]))
+                    {
+                        continue;
+                    }
+
+                    const auto child{ codec.move(state, tops[from], from, to) };
+                    if (table.insert(child, state))
+                    {
+                        next.push_back(child);
+                        if (child == goal)
+                        {
+                            found.store(true, std::memory_order_relaxed);
+                        }
+                    }
+                }
+            }
+        }
+    }
+};
+
+class HanoiAnalysis
+{
+public:
+    using size_type = std::uint_fast64_t;
+
+    static constexpr std::size_t pegs{ 3 };
+    static constexpr std::size_t max_disks{ std::numeric_limits<size_type>::digits };
+
+public:
+    // Walking from the largest disk down: a disk already on its target leaves the target unchanged. Otherwise it
+    // costs 2^(d-1) moves, because every smaller disk must first gather on the third peg.
+    [[nodiscard]] static std::optional<size_type> distance(std::span<const PegId> pegOfDisk, PegId target)
+    {
+        if (pegOfDisk.size() > max_disks || target >= pegs)
+        {
+            return std::nullopt;
+        }
+
+        size_type moves{ 0 };
+        for (auto disk{ pegOfDisk.size() }; disk > 0; --disk)
+        {
+            if (const auto peg{ pegOfDisk[disk - 1] }; peg != target)
+            {
+                moves += size_type{ 1 } << (disk - 1);
+                target = third(peg, target);
+            }
+        }
+        return moves;
+    }
+
+    // The optimal move always belongs to the smallest disk that is not on its target in that walk.
+    [[nodiscard]] static std::optional<HanoiMove> nextMove(std::span<const PegId> pegOfDisk, PegId target)
+    {
+        if (target >= pegs)
+        {
+            return std::nullopt;
+        }
+
+        std::optional<HanoiMove> move{};
+        for (auto disk{ pegOfDisk.size() }; disk > 0; --disk)
+        {
+            if (const auto peg{ pegOfDisk[disk - 1] }; peg != target)
+            {
+                move = HanoiMove{ .from = peg, .to = target };
+                target = third(peg, target);
+            }
+        }
+        return move;
+    }
+
+    template<typename Tower, typename Allocator>
+    [[nodiscard]] static std::optional<size_type> distance(const BasicTowerOfHanoi<Tower, Allocator>& engine,
+                                                           PegId target)
+    {
+        if (engine.size() != pegs)
+        {
+            return std::nullopt;
+        }
+        auto pegOfDisk{ HanoiStateCodec::assignment(engine) };
+        return pegOfDisk ? distance(*pegOfDisk, target) : std::nullopt;
+    }
+
+    template<typename Tower, typename Allocator>
+    [[nodiscard]] static std::optional<HanoiMove> nextMove(const BasicTowerOfHanoi<Tower, Allocator>& engine,
+                                                           PegId target)
+    {
+        if (engine.size() != pegs)
+        {
+            return std::nullopt;
+        }
+        auto pegOfDisk{ HanoiStateCodec::assignment(engine) };
+        return pegOfDisk ? nextMove(*pegOfDisk, target) : std::nullopt;
+    }
+
+private:
+    [[nodiscard]] static constexpr PegId third(PegId first, PegId second)
+    {
+        return pegs - first - second;
+    }
+};
+
+// Pegs packed two bits per disk into 64-bit words, the layout shared by ConcurrentTowerOfHanoi and
+// PackedTowerOfHanoi. Every test is a SWAR pass over all the lanes of a word at once.
+struct HanoiPegLanes
+{
+    using word_type = std::uint64_t;
+
+    static constexpr unsigned peg_bits{ 2 };
+    static constexpr std::size_t max_pegs{ std::size_t{ 1 } << peg_bits };
+    static constexpr std::size_t lanes_per_word{ std::numeric_limits<word_type>::digits / peg_bits };
+    static constexpr word_type low_lanes{ std::numeric_limits<word_type>::max() / ((word_type{ 1 } << peg_bits) - 1) };
+
+    // id repeated in every lane: the word of a position with every disk on id.
+    [[nodiscard]] static constexpr word_type spread(PegId id)
+    {
+        return low_lanes * static_cast<word_type>(id);
+    }
+
+    // The low bit of every lane holding id: after xor-ing with the spread peg a lane matches exactly when both of
+    // its bits are clear.
+    [[nodiscard]] static constexpr word_type occupied(word_type word, PegId id)
+    {
+        const auto difference{ word ^ spread(id) };
+        return ~(difference | difference >> 1) & low_lanes;
+    }
+
+    [[nodiscard]] static constexpr PegId peg(word_type word, std::size_t lane)
+    {
+        return static_cast<PegId>(word >> lane * peg_bits & (max_pegs - 1));
+    }
+
+    // The lane of a single bit, or of the lowest set bit, of an occupied() mask.
+    [[nodiscard]] static constexpr std::size_t lane(word_type occupied)
+    {
+        return static_cast<std::size_t>(std::countr_zero(occupied)) / peg_bits;
+    }
+};
+
+// A small puzzle shared between threads. The whole state is one atomic word holding, two bits per disk, the peg
+// each disk sits on, so a move is validated against a loaded word and committed with compare_exchange: movers
+// never lock or block each other, and a reader's single load is always a consistent position.
+class ConcurrentTowerOfHanoi
+{
+public:
+    using word_type = std::uint64_t;
+    using id_type = PegId;
+    using size_type = std::size_t;
+    using disk_type = std::uint_fast32_t;
+    using apply_result_type = TheTowerOfHanoi::apply_result_type;
+
+    static constexpr unsigned peg_bits{ HanoiPegLanes::peg_bits };
+    static constexpr size_type max_pegs{ HanoiPegLanes::max_pegs };
+    static constexpr size_type max_disks{ HanoiPegLanes::lanes_per_word };
+
+    class snapshot_type
+    {
+    public:
+        constexpr snapshot_type(word_type word, size_type pegs, size_type disks)
+                : m_word{ word }, m_pegs{ pegs }, m_disks{ disks }
+        {
+        }
+
+        [[nodiscard]] constexpr word_type word() const
+        {
+            return m_word;
+        }
+
+        [[nodiscard]] constexpr size_type pegs() const
+        {
+            return m_pegs;
+        }
+
+        [[nodiscard]] constexpr size_type disks() const
+        {
+            return m_disks;
+        }
+
+        [[nodiscard]] constexpr PegId peg(size_type disk) const
+        {
+            return HanoiPegLanes::peg(m_word, disk - 1);
+        }
+
+        [[nodiscard]] constexpr bool empty(id_type id) const
+        {
+            return lanes(m_word, id, m_disks) == 0;
+        }
+
+        [[nodiscard]] constexpr size_type size(id_type id) const
+        {
+            return static_cast<size_type>(std::popcount(lanes(m_word, id, m_disks)));
+        }
+
+        // The smallest disk on the peg; the peg must not be empty.
+        [[nodiscard]] constexpr disk_type top(id_type id) const
+        {
+            return static_cast<disk_type>(HanoiPegLanes::lane(lanes(m_word, id, m_disks)) + 1);
+        }
+
+        // Largest disk first: repeatedly takes the highest lane of the peg's occupancy mask.
+        template<std::invocable<disk_type> F>
+        constexpr void forEach(id_type id, F&& f) const
+        {
+            for (auto occupied{ lanes(m_word, id, m_disks) }; occupied != 0; occupied &= ~std::bit_floor(occupied))
+            {
+                f(static_cast<disk_type>(HanoiPegLanes::lane(std::bit_floor(occupied)) + 1));
+            }
+        }
+
+        [[nodiscard]] std::vector<PegId> assignment() const
+        {
+            std::vector<PegId> pegOfDisk(m_disks);
+            for (size_type disk{ 1 }; disk <= m_disks; ++disk)
+            {
+                pegOfDisk[disk - 1] = peg(disk);
+            }
+            return pegOfDisk;
+        }
+
+        friend constexpr bool operator==(const snapshot_type&, const snapshot_type&) = default;
+
+        friend std::ostream& operator<<(std::ostream& os, const snapshot_type& snapshot)
+        {
+            for (id_type id{ 0 }; id < snapshot.pegs(); ++id)
+            {
+                os << id << '#';
+                snapshot.forEach(id, [&os](disk_type disk)
+                {
+                    os << disk;
+                });
+                os << '\n';
+            }
+            return os;
+        }
+
+    private:
+        word_type m_word;
+        size_type m_pegs;
+        size_type m_disks;
+    };
+
+public:
+    // All disks start on source.
+    ConcurrentTowerOfHanoi(size_type pegs, size_type disks, id_type source = 0)
+            : m_pegs{ pegs }, m_disks{ disks }, m_word{ HanoiPegLanes::spread(source) & diskMask(disks) }
+    {
+        if (!representable(pegs, disks) || source >= pegs)
+        {
+            throw std::invalid_argument{ "ConcurrentTowerOfHanoi: pegs" };
+        }
+    }
+
+    ConcurrentTowerOfHanoi(size_type pegs, std::span<const PegId> pegOfDisk)
+            : m_pegs{ pegs }, m_disks{ pegOfDisk.size() }, m_word{ pack(pegOfDisk) }
+    {
+        if (!representable(pegs, pegOfDisk.size())
+            || std::ranges::any_of(pegOfDisk, [pegs](PegId peg) { return peg >= pegs; }))
+        {
+            throw std::invalid_argument{ "ConcurrentTowerOfHanoi: pegs" };
+        }
+    }
+
+    [[nodiscard]] static constexpr bool representable(size_type pegs, size_type disks)
+    {
+        return pegs >= 1 && pegs <= max_pegs && disks <= max_disks;
+    }
+
+    // A concurrent copy of an engine's position, provided its disks are exactly 1..n and it fits in a word.
+    template<typename Tower, typename Allocator, typename Rules>
+    [[nodiscard]] static std::optional<ConcurrentTowerOfHanoi>
+    from(const BasicTowerOfHanoi<Tower, Allocator, Rules>& engine)
+    {
+        auto pegOfDisk{ HanoiStateCodec::assignment(engine) };
+        if (!pegOfDisk || !representable(engine.size(), pegOfDisk->size()))
+        {
+            return std::nullopt;
+        }
+        return std::optional<ConcurrentTowerOfHanoi>{ std::in_place, engine.size(), *pegOfDisk };
+    }
+
+    [[nodiscard]] bool has(id_type id) const
+    {
+        return id < m_pegs;
+    }
+
+    [[nodiscard]] size_type size() const
+    {
+        return m_pegs;
+    }
+
+    [[nodiscard]] size_type disks() const
+    {
+        return m_disks;
+    }
+
+    [[nodiscard]] snapshot_type snapshot() const
+    {
+        return { m_word.load(std::memory_order_acquire), m_pegs, m_disks };
+    }
+
+    bool move(id_type fromId, id_type toId)
+    {
+        if (has(fromId) && has(toId))
+        {
+            auto word{ m_word.load(std::memory_order_acquire) };
+            for (std::optional<word_type> next; (next = step(word, fromId, toId, m_disks));)
+            {
+                if (m_word.compare_exchange_weak(word, *next, std::memory_order_acq_rel, std::memory_order_acquire))
+                {
+                    HanoiStats::increment(HanoiCounter::moves);
+                    return true;
+                }
+            }
+        }
+
+        HanoiStats::increment(HanoiCounter::rejected_moves);
+        return false;
+    }
+
+    // Plays the longest valid prefix of moves as one atomic step: no reader ever sees a partly applied batch,
+    // and a batch that races with another writer is replayed against the newer position.
+    apply_result_type apply(std::span<const HanoiMove> moves)
+    {
+        auto word{ m_word.load(std::memory_order_acquire) };
+        while (true)
+        {
+            auto next{ word };
+            std::size_t count{ 0 };
+            for (; count < moves.size(); ++count)
+            {
+                const auto [fromId, toId]{ moves[count] };
+                auto stepped{ has(fromId) && has(toId) ? step(next, fromId, toId, m_disks) : std::nullopt };
+                if (!stepped)
+                {
+                    break;
+                }
+                next = *stepped;
+            }
+
+            if (count == 0 || m_word.compare_exchange_weak(word, next, std::memory_order_acq_rel,
+                                                           std::memory_order_acquire))
+            {
+                HanoiStats::increment(HanoiCounter::moves, count);
+                if (count != moves.size())
+                {
+                    HanoiStats::increment(HanoiCounter::rejected_moves);
+                }
+                return { .ok = count == moves.size(), .index = count };
+            }
+        }
+    }
+
+private:
+    [[nodiscard]] static constexpr word_type diskMask(size_type disks)
+    {
+        return disks >= max_disks ? std::numeric_limits<word_type>::max()
+                                  : (word_type{ 1 } << disks * peg_bits) - 1;
+    }
+
+    // The low lane bit of every disk on the peg, ignoring the unused lanes above the last disk.
+    [[nodiscard]] static constexpr word_type lanes(word_type word, id_type id, size_type disks)
+    {
+        return HanoiPegLanes::occupied(word, id) & diskMask(disks);
+    }
+
+    [[nodiscard]] static constexpr std::optional<word_type> step(word_type word, id_type fromId, id_type toId,
+                                                                  size_type disks)
+    {
+        const auto from{ lanes(word, fromId, disks) };
+        const auto to{ lanes(word, toId, disks) };
+        const auto top{ from & -from };
+        if (fromId == toId || from == 0 || (to != 0 && (to & -to) < top))
+        {
+            return std::nullopt;
+        }
+        return word ^ static_cast<word_type>(fromId ^ toId) << std::countr_zero(top);
+    }
+
+    [[nodiscard]] static word_type pack(std::span<const PegId> pegOfDisk)
+    {
+        word_type word{ 0 };
+        for (auto disk{ pegOfDisk.size() }; disk > 0; --disk)
+        {
+            word = word << peg_bits | static_cast<word_type>(pegOfDisk[disk - 1]);
+        }
+        return word;
+    }
+
+private:
+    size_type m_pegs;
+    size_type m_disks;
+    std::atomic<word_type> m_word;
+};
+
+// Checks a submitted three-peg solution that starts with every disk on peg 0 and should end on peg 2. The move
+// stream is cut into chunks that are replayed in parallel. Each chunk starts from the position the optimal
+// solution has reached at that index, which the closed form gives directly. Chunks are then stitched in order.
+// A chunk whose guessed start matches the true position is already checked; any other chunk is replayed again
+// from the true position. Optimal or near-optimal submissions are verified at full parallelism, and arbitrary
+// ones still get an exact answer.
+class HanoiVerifier
+{
+public:
+    using size_type = std::size_t;
+    using board_type = std::uint64_t;
+    using state_type = std::array<board_type, 3>;
+    struct result_type
+    {
+        bool ok{ false };
+        bool solved{ false };
+        size_type index{ 0 };
+    };
+
+    static constexpr size_type pegs{ 3 };
+    static constexpr size_type max_disks{ HanoiMoveView::max_disks };
+    static constexpr size_type chunk_size{ size_type{ 1 } << 18 };
+
+public:
+    // ok is false when a move is illegal, and index is then the first such move.
+    [[nodiscard]] static std::optional<result_type> verify(size_type disks, std::span<const HanoiMove> moves)
+    {
+        if (disks > max_disks)
+        {
+            return std::nullopt;
+        }
+        auto state{ start(disks) };
+        return finish(disks, replay(state, moves), state, moves.size());
+    }
+
+    [[nodiscard]] static std::optional<result_type> verify(size_type disks, std::span<const HanoiMove> moves,
+                                                           HanoiThreadPool& pool)
+    {
+        if (disks > max_disks)
+        {
+            return std::nullopt;
+        }
+
+        const auto chunks{ (moves.size() + chunk_size - 1) / chunk_size };
+        if (chunks <= 1)
+        {
+            return verify(disks, moves);
+        }
+
+        struct chunk_type
+        {
+            std::optional<state_type> guess;
+            state_type state;
+            size_type legal;
+        };
+        std::vector<chunk_type> results(chunks);
+        const HanoiMoveView solution{ disks };
+        for (size_type chunk{ 1 }; chunk < chunks; ++chunk)
+        {
+            pool.submit([&, chunk]
+                        {
+                            auto& result{ results[chunk] };
+                            const auto begin{ chunk * chunk_size };
+                            if (begin > solution.size())
+                            {
+                                return;
+                            }
+                            result.guess = optimal(solution, begin);
+                            result.state = *result.guess;
+                            result.legal = replay(result.state, slice(moves, chunk));
+                        });
+        }
+        auto state{ start(disks) };
+        auto legal{ replay(state, slice(moves, 0)) };
+        pool.wait();
+
+        for (size_type chunk{ 1 }; chunk < chunks && legal == chunk * chunk_size; ++chunk)
+        {
+            if (const auto& result{ results[chunk] }; result.guess == state)
+            {
+                state = result.state;
+                legal += result.legal;
+            }
+            else
+            {
+                legal += replay(state, slice(moves, chunk));
+            }
+        }
+        return finish(disks, legal, state, moves.size());
+    }
+
+private:
+    [[nodiscard]] static constexpr board_type allDisks(size_type disks)
+    {
+        return (board_type{ 1 } << disks) - 1;
+    }
+
+    [[nodiscard]] static constexpr state_type start(size_type disks)
+    {
+        return { allDisks(disks), 0, 0 };
+    }
+
+    [[nodiscard]] static state_type optimal(const HanoiMoveView& solution, size_type count)
+    {
+        state_type state{};
+        for (size_type disk{ 1 }; disk <= solution.disks(); ++disk)
+        {
+            state[solution.peg(disk, count)] |= board_type{ 1 } << (disk - 1);
+        }
+        return state;
+    }
+
+    [[nodiscard]] static std::span<const HanoiMove> slice(std::span<const HanoiMove> moves, size_type chunk)
+    {
+        const auto begin{ chunk * chunk_size };
+        return moves.subspan(begin, std::min(chunk_size, moves.size() - begin));
+    }
+
+    // Plays moves until the first illegal one and returns how many were legal. A move is legal when its source
+    // peg is occupied and the destination holds no disk up to the moving one.
+    [[nodiscard]] static size_type replay(state_type& state, std::span<const HanoiMove> moves)
+    {
+        for (size_type i{ 0 }; i < moves.size(); ++i)
+        {
+            const auto [from, to]{ moves[i] };
+            if (from >= pegs || to >= pegs)
+            {
+                return i;
+            }
+            const auto top{ state[from] & -state[from] };
+            if (top == 0 || (state[to] & ((top << 1) - 1)) != 0)
+            {
+                return i;
+            }
+            state[from] ^= top;
+            state[to] |= top;
+        }
+        return moves.size();
+    }
+
+    [[nodiscard]] static result_type finish(size_type disks, size_type legal, const state_type& state,
+                                            size_type count)
+    {
+        HanoiStats::increment(HanoiCounter::moves, legal);
+        if (legal != count)
+        {
+            HanoiStats::increment(HanoiCounter::rejected_moves);
+            return { .ok = false, .solved = false, .index = legal };
+        }
+        return { .ok = true, .solved = state[pegs - 1] == allDisks(disks), .index = legal };
+    }
+};
+
+// Many small independent games stored as a structure of arrays: one contiguous vector of bitboards per peg, indexed
+// by game. step() applies one move to every game at once with a branchless kernel. The source and destination
+// boards are picked by mask, legality is a compare, and rejected games are left untouched by masking the moved
+// disk to zero. The loop auto-vectorises, and AVX2 builds use an explicit eight-game kernel for 32-bit boards.
+template<std::size_t Pegs = 3, std::unsigned_integral Word = std::uint32_t> requires (Pegs >= 1 && Pegs < 256)
+class HanoiBatchEngine
+{
+public:
+    using word_type = Word;
+    using tower_type = HanoiTower<std::uint_fast32_t, HanoiBitboard<word_type>>;
+    using id_type = std::uint8_t;
+    using size_type = std::size_t;
+
+    static constexpr size_type peg_count{ Pegs };
+    static constexpr size_type max_disks{ std::numeric_limits<word_type>::digits };
+
+public:
+    HanoiBatchEngine(size_type games, size_type disks, id_type source = 0)
+            : m_games{ games }, m_disks{ disks }
+    {
+        if (disks > max_disks)
+        {
+            throw std::length_error{ "HanoiBatchEngine: too many disks" };
+        }
+        reset(source);
+    }
+
+    [[nodiscard]] size_type size() const
+    {
+        return m_games;
+    }
+
+    [[nodiscard]] size_type disks() const
+    {
+        return m_disks;
+    }
+
+    [[nodiscard]] word_type board(size_type game, id_type peg) const
+    {
+        return m_boards[peg][game];
+    }
+
+    [[nodiscard]] tower_type tower(size_type game, id_type peg) const
+    {
+        return tower_type{ HanoiBitboard<word_type>{ board(game, peg) }};
+    }
+
+    [[nodiscard]] bool solved(size_type game, id_type target) const
+    {
+        return board(game, target) == allDisks();
+    }
+
+    // Puts every game back at the start, all disks on source.
+    void reset(id_type source = 0)
+    {
+        for (size_type peg{ 0 }; peg < Pegs; ++peg)
+        {
+            m_boards[peg].assign(m_games, peg == source ? allDisks() : word_type{ 0 });
+        }
+    }
+
+    // Moves game i's top disk from peg from[i] to peg to[i], for every game in the shorter of the two spans.
+    // Illegal moves are skipped; the return value counts the moves that were played.
+    size_type step(std::span<const id_type> from, std::span<const id_type> to)
+    {
+        const auto games{ std::min({ m_games, from.size(), to.size() }) };
+        HanoiTraceSpan span{ HanoiEvent::batch_step, games };
+        size_type game{ 0 };
+        size_type accepted{ 0 };
+#if defined(__AVX2__)
+        if constexpr (std::same_as<word_type, std::uint32_t>)
+        {
+            accepted += stepAvx2(from.data(), to.data(), games, game);
+        }
+#endif
+        accepted += stepScalar(from.data(), to.data(), games, game);
+
+        HanoiStats::increment(HanoiCounter::moves, accepted);
+        HanoiStats::increment(HanoiCounter::rejected_moves, games - accepted);
+        span.arguments(games, accepted);
+        return accepted;
+    }
+
+private:
+    [[nodiscard]] word_type allDisks() const
+    {
+        return m_disks == max_disks ? std::numeric_limits<word_type>::max()
+                                    : static_cast<word_type>((word_type{ 1 } << m_disks) - 1);
+    }
+
+    [[nodiscard]] static constexpr word_type select(bool condition)
+    {
+        return static_cast<word_type>(-static_cast<word_type>(condition));
+    }
+
+    size_type stepScalar(const id_type* from, const id_type* to, size_type games, size_type game)
+    {
+        std::array<word_type*, Pegs> boards{};
+        for (size_type peg{ 0 }; peg < Pegs; ++peg)
+        {
+            boards[peg] = m_boards[peg].data();
+        }
+
+        size_type accepted{ 0 };
+        for (; game < games; ++game)
+        {
+            const auto fromId{ from[game] };
+            const auto toId{ to[game] };
+            word_type source{ 0 };
+            word_type target{ 0 };
+            for (size_type peg{ 0 }; peg < Pegs; ++peg)
+            {
+                source |= boards[peg][game] & select(fromId == peg);
+                target |= boards[peg][game] & select(toId == peg);
+            }
+
+            // A source outside the pegs reads as empty and a same-peg move finds its own top below it; only an
+            // out-of-range target needs an explicit check.
+            const auto top{ static_cast<word_type>(source & -source) };
+            const auto below{ static_cast<word_type>((top << 1) - 1) };
+            const auto legal{ static_cast<word_type>((top != 0) & ((target & below) == 0) & (toId < Pegs)) };
+            const auto moved{ static_cast<word_type>(top & -legal) };
+            for (size_type peg{ 0 }; peg < Pegs; ++peg)
+            {
+                boards[peg][game] ^= moved & static_cast<word_type>(select(fromId == peg) | select(toId == peg));
+            }
+            accepted += legal;
+        }
+        return accepted;
+    }
+
+#if defined(__AVX2__)
+    size_type stepAvx2(const id_type* from, const id_type* to, size_type games, size_type& game)
+    {
+        constexpr size_type lanes{ sizeof(__m256i) / sizeof(std::uint32_t) };
+        const auto zero{ _mm256_setzero_si256() };
+        const auto one{ _mm256_set1_epi32(1) };
+        const auto pegCount{ _mm256_set1_epi32(static_cast<int>(Pegs)) };
+
+        size_type accepted{ 0 };
+        for (; game + lanes <= games; game += lanes)
+        {
+            const auto fromIds{ _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(from + game))) };
+            const auto toIds{ _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(to + game))) };
+
+            __m256i boards[Pegs];
+            __m256i touched[Pegs];
+            auto source{ zero };
+            auto target{ zero };
+            for (size_type peg{ 0 }; peg < Pegs; ++peg)
+            {
+                const auto id{ _mm256_set1_epi32(static_cast<int>(peg)) };
+                const auto isFrom{ _mm256_cmpeq_epi32(fromIds, id) };
+                const auto isTo{ _mm256_cmpeq_epi32(toIds, id) };
+                boards[peg] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(m_boards[peg].data() + game));
+                touched[peg] = _mm256_or_si256(isFrom, isTo);
+                source = _mm256_or_si256(source, _mm256_and_si256(boards[peg], isFrom));
+                target = _mm256_or_si256(target, _mm256_and_si256(boards[peg], isTo));
+            }
+
+            const auto top{ _mm256_and_si256(source, _mm256_sub_epi32(zero, source)) };
+            const auto below{ _mm256_sub_epi32(_mm256_add_epi32(top, top), one) };
+            const auto legal{ _mm256_and_si256(
+                    _mm256_andnot_si256(_mm256_cmpeq_epi32(top, zero),
+                                        _mm256_cmpeq_epi32(_mm256_and_si256(target, below), zero)),
+                    _mm256_cmpgt_epi32(pegCount, toIds)) };
+            const auto moved{ _mm256_and_si256(top, legal) };
+            for (size_type peg{ 0 }; peg < Pegs; ++peg)
+            {
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(m_boards[peg].data() + game),
+                                    _mm256_xor_si256(boards[peg], _mm256_and_si256(moved, touched[peg])));
+            }
+            accepted += static_cast<size_type>(std::popcount(static_cast<unsigned>(
+                    _mm256_movemask_ps(_mm256_castsi256_ps(legal)))));
+        }
+        return accepted;
+    }
+#endif
+
+private:
+    size_type m_games;
+    size_type m_disks;
+    std::array<std::vector<word_type>, Pegs> m_boards{};
+};
+
+// Towers far too tall for one tower object per peg: two bits per disk hold the peg it sits on, so 10^8 disks take
+// 25 MB. Filling a peg stores the lane pattern in every word. A move scans from the smallest disk for the first one on
+// either peg, 32 disks per word, and plays it only if it sits on the source peg.
+class PackedTowerOfHanoi
+{
+public:
+    using word_type = std::uint64_t;
+    using id_type = PegId;
+    using size_type = std::size_t;
+    using container_type = std::vector<word_type>;
+    using apply_result_type = TheTowerOfHanoi::apply_result_type;
+
+    static constexpr unsigned peg_bits{ HanoiPegLanes::peg_bits };
+    static constexpr size_type max_pegs{ HanoiPegLanes::max_pegs };
+    static constexpr size_type disks_per_word{ HanoiPegLanes::lanes_per_word };
+
+public:
+    // Throws std::invalid_argument unless representable(pegs) and source is one of the pegs: a larger peg id would
+    // not fit in its lane.
+    PackedTowerOfHanoi(size_type pegs, size_type disks, id_type source = 0)
+            : m_pegs{ pegs }, m_disks{ disks }, m_words((disks + disks_per_word - 1) / disks_per_word)
+    {
+        if (!representable(pegs) || source >= pegs)
+        {
+            throw std::invalid_argument{ "PackedTowerOfHanoi: pegs" };
+        }
+        fill(source);
+    }
+
+    [[nodiscard]] static constexpr bool representable(size_type pegs)
+    {
+        return pegs >= 1 && pegs <= max_pegs;
+    }
+
+    [[nodiscard]] bool has(id_type id) const
+    {
+        return id < m_pegs;
+    }
+
+    [[nodiscard]] size_type size() const
+    {
+        return m_pegs;
+    }
+
+    [[nodiscard]] size_type disks() const
+    {
+        return m_disks;
+    }
+
+    [[nodiscard]] size_type bytes() const
+    {
+        return m_words.size() * sizeof(word_type);
+    }
+
+    [[nodiscard]] const container_type& words() const
+    {
+        return m_words;
+    }
+
+    [[nodiscard]] id_type peg(size_type disk) const
+    {
+        const auto index{ disk - 1 };
+        return HanoiPegLanes::peg(m_words[index / disks_per_word], index % disks_per_word);
+    }
+
+    // Moves every disk onto one peg.
+    void fill(id_type id)
+    {
+        std::ranges::fill(m_words, HanoiPegLanes::spread(id));
+    }
+
+    [[nodiscard]] size_type count(id_type id) const
+    {
+        size_type disks{ 0 };
+        for (size_type index{ 0 }; index < m_words.size(); ++index)
+        {
+            disks += static_cast<size_type>(std::popcount(lanes(index, id)));
+        }
+        return disks;
+    }
+
+    [[nodiscard]] bool empty(id_type id) const
+    {
+        return !top(id);
+    }
+
+    [[nodiscard]] std::optional<size_type> top(id_type id) const
+    {
+        for (size_type index{ 0 }; index < m_words.size(); ++index)
+        {
+            if (const auto occupied{ lanes(index, id) }; occupied != 0)
+            {
+                return disk(index, occupied);
+            }
+        }
+        return std::nullopt;
+    }
+
+    // Largest disk first, walking the words from the last down and each word's lanes from the highest; the cost is
+    // a pass over every word whatever the peg holds.
+    template<std::invocable<size_type> F>
+    void forEach(id_type id, F&& f) const
+    {
+        for (auto index{ m_words.size() }; index > 0; --index)
+        {
+            for (auto occupied{ lanes(index - 1, id) }; occupied != 0; occupied &= ~std::bit_floor(occupied))
+            {
+                f(disk(index - 1, std::bit_floor(occupied)));
+            }
+        }
+    }
+
+    bool move(id_type fromId, id_type toId)
+    {
+        if (step(fromId, toId))
+        {
+            HanoiStats::increment(HanoiCounter::moves);
+            return true;
+        }
+        HanoiStats::increment(HanoiCounter::rejected_moves);
+        return false;
+    }
+
+    apply_result_type apply(std::span<const HanoiMove> moves)
+    {
+        for (std::size_t i{ 0 }; i < moves.size(); ++i)
+        {
+            if (!step(moves[i].from, moves[i].to))
+            {
+                HanoiStats::increment(HanoiCounter::moves, i);
+                HanoiStats::increment(HanoiCounter::rejected_moves);
+                return { .ok = false, .index = i };
+            }
+        }
+        HanoiStats::increment(HanoiCounter::moves, moves.size());
+        return { .ok = true, .index = moves.size() };
+    }
+
+private:
+    // The low lane bit of every disk of the word that sits on the peg; lanes past the last disk are masked off.
+    [[nodiscard]] word_type lanes(size_type index, id_type id) const
+    {
+        auto occupied{ HanoiPegLanes::occupied(m_words[index], id) };
+        if (const auto used{ m_disks - index * disks_per_word }; used < disks_per_word)
+        {
+            occupied &= (word_type{ 1 } << used * peg_bits) - 1;
+        }
+        return occupied;
+    }
+
+    [[nodiscard]] static size_type disk(size_type index, word_type occupied)
+    {
+        return index * disks_per_word + HanoiPegLanes::lane(occupied) + 1;
+    }
+
+    bool step(id_type fromId, id_type toId)
+    {
+        if (!has(fromId) || !has(toId) || fromId == toId)
+        {
+            return false;
+        }
+
+        for (size_type index{ 0 }; index < m_words.size(); ++index)
+        {
+            const auto onFrom{ lanes(index, fromId) };
+            const auto either{ onFrom | lanes(index, toId) };
+            if (either == 0)
+            {
+                continue;
+            }
+
+            const auto lowest{ either & -either };
+            if ((onFrom & lowest) == 0)
+            {
+                return false;
+            }
+            m_words[index] ^= static_cast<word_type>(fromId ^ toId) << std::countr_zero(lowest);
+            return true;
+        }
+        return false;
+    }
+
+private:
+    size_type m_pegs;
+    size_type m_disks;
+    container_type m_words;
+};
+
+// An immutable position whose pegs are shared, singly linked stacks. A move links one new node onto the target
+// and builds a new peg table, and every other disk is shared with the parent position. Copying a position
+// copies one pointer, so exploring many alternative lines from one parent costs memory only for the moves made.
+class PersistentTowerOfHanoi
+{
+public:
+    using disk_type = std::uint_fast32_t;
+    using id_type = PegId;
+    using size_type = std::size_t;
+    using apply_result_type = TheTowerOfHanoi::apply_result_type;
+
+    class peg_type
+    {
+    public:
+        peg_type() = default;
+        peg_type(const peg_type&) = default;
+        peg_type(peg_type&&) noexcept = default;
+
+        peg_type& operator=(peg_type other) noexcept
+        {
+            std::swap(m_top, other.m_top);
+            std::swap(m_size, other.m_size);
+            return *this;
+        }
+
+        // Releases an unshared run of nodes in a loop; a tall tower would otherwise be freed by deep recursion.
+        // Assignment goes through a by-value parameter so replaced towers are released the same way.
+        ~peg_type()
+        {
+            for (auto node{ std::move(m_top) }; node && node.use_count() == 1;)
+            {
+                node = std::move(node->next);
+            }
+        }
+
+        [[nodiscard]] bool empty() const
+        {
+            return m_size == 0;
+        }
+
+        [[nodiscard]] size_type size() const
+        {
+            return m_size;
+        }
+
+        [[nodiscard]] disk_type top() const
+        {
+            return m_top->disk;
+        }
+
+        [[nodiscard]] bool placeable(disk_type disk) const
+        {
+            return empty() || top() > disk;
+        }
+
+        // Largest disk first. The list is linked from the top, so the disks are gathered into a vector and walked in
+        // reverse.
+        template<std::invocable<disk_type> F>
+        void forEach(F&& f) const
+        {
+            std::vector<disk_type> disks{};
+            disks.reserve(m_size);
+            for (auto* node{ m_top.get() }; node != nullptr; node = node->next.get())
+            {
+                disks.push_back(node->disk);
+            }
+            std::ranges::for_each(disks | std::views::reverse, f);
+        }
+
+        friend bool operator==(const peg_type& lhs, const peg_type& rhs)
+        {
+            if (lhs.m_size != rhs.m_size)
+            {
+                return false;
+            }
+            auto* left{ lhs.m_top.get() };
+            auto* right{ rhs.m_top.get() };
+            for (; left != right; left = left->next.get(), right = right->next.get())
+            {
+                if (left->disk != right->disk)
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+    private:
+        friend class PersistentTowerOfHanoi;
+
+        struct node_type
+        {
+            disk_type disk;
+            std::shared_ptr<node_type> next;
+        };
+
+        void push(disk_type disk)
+        {
+            m_top = std::make_shared<node_type>(node_type{ .disk = disk, .next = std::move(m_top) });
+            ++m_size;
+        }
+
+        void pop()
+        {
+            m_top = m_top->next;
+            --m_size;
+        }
+
+    private:
+        std::shared_ptr<node_type> m_top{};
+        size_type m_size{ 0 };
+    };
+
+    using container_type = std::vector<peg_type>;
+
+public:
+    // All disks start on source.
+    PersistentTowerOfHanoi(size_type pegs, size_type disks, id_type source = 0)
+    {
+        if (source >= pegs)
+        {
+            throw std::invalid_argument{ "PersistentTowerOfHanoi: source" };
+        }
+
+        container_type table(pegs);
+        for (auto disk{ disks }; disk > 0; --disk)
+        {
+            table[source].push(static_cast<disk_type>(disk));
+            m_hash ^= TheTowerOfHanoi::zobrist(static_cast<disk_type>(disk), source);
+        }
+        m_pegs = std::make_shared<const container_type>(std::move(table));
+    }
+
+    template<typename Tower, typename Allocator, typename Rules>
+    [[nodiscard]] static PersistentTowerOfHanoi from(const BasicTowerOfHanoi<Tower, Allocator, Rules>& engine)
+    {
+        container_type table(engine.size());
+        std::uint64_t hash{ 0 };
+        for (id_type id{ 0 }; id < engine.size(); ++id)
+        {
+            engine.select(id).forEach([&table, &hash, id](const auto& disk)
+                                      {
+                                          table[id].push(static_cast<disk_type>(disk));
+                                          hash ^= TheTowerOfHanoi::zobrist(static_cast<disk_type>(disk), id);
+                                      });
+        }
+        return PersistentTowerOfHanoi{ std::make_shared<const container_type>(std::move(table)), hash };
+    }
+
+    [[nodiscard]] bool has(id_type id) const
+    {
+        return id < m_pegs->size();
+    }
+
+    [[nodiscard]] size_type size() const
+    {
+        return m_pegs->size();
+    }
+
+    [[nodiscard]] const peg_type& select(id_type id) const
+    {
+        return (*m_pegs)[id];
+    }
+
+    // Matches BasicTowerOfHanoi::hash() for the same position.
+    [[nodiscard]] std::uint64_t hash() const
+    {
+        return m_hash;
+    }
+
+    // The position after one move, sharing every untouched disk with this one; nullopt if the move is illegal.
+    [[nodiscard]] std::optional<PersistentTowerOfHanoi> move(id_type fromId, id_type toId) const
+    {
+        if (!legal(*m_pegs, fromId, toId))
+        {
+            HanoiStats::increment(HanoiCounter::rejected_moves);
+            return std::nullopt;
+        }
+
+        auto table{ *m_pegs };
+        auto hash{ m_hash };
+        play(table, hash, fromId, toId);
+        HanoiStats::increment(HanoiCounter::moves);
+        return PersistentTowerOfHanoi{ std::make_shared<const container_type>(std::move(table)), hash };
+    }
+
+    // The position after the longest legal prefix of moves, built with a single new peg table.
+    [[nodiscard]] std::pair<PersistentTowerOfHanoi, apply_result_type> apply(std::span<const HanoiMove> moves) const
+    {
+        auto table{ *m_pegs };
+        auto hash{ m_hash };
+        std::size_t count{ 0 };
+        for (; count < moves.size() && legal(table, moves[count].from, moves[count].to); ++count)
+        {
+            play(table, hash, moves[count].from, moves[count].to);
+        }
+
+        HanoiStats::increment(HanoiCounter::moves, count);
+        if (count != moves.size())
+        {
+            HanoiStats::increment(HanoiCounter::rejected_moves);
+        }
+        return { PersistentTowerOfHanoi{ std::make_shared<const container_type>(std::move(table)), hash },
+                 { .ok = count == moves.size(), .index = count } };
+    }
+
+    friend bool operator==(const PersistentTowerOfHanoi& lhs, const PersistentTowerOfHanoi& rhs)
+    {
+        return lhs.m_pegs == rhs.m_pegs || (lhs.m_hash == rhs.m_hash && *lhs.m_pegs == *rhs.m_pegs);
+    }
+
+    friend std::ostream& operator<<(std::ostream& os, const PersistentTowerOfHanoi& theTowerOfHanoi)
+    {
+        for (id_type id{ 0 }; id < theTowerOfHanoi.size(); ++id)
+        {
+            os << id << '#';
+            theTowerOfHanoi.select(id).forEach([&os](disk_type disk)
+                                               {
+                                                   os << disk;
+                                               });
+            os << '\n';
+        }
+        return os;
+    }
+
+private:
+    PersistentTowerOfHanoi(std::shared_ptr<const container_type> pegs, std::uint64_t hash)
+            : m_pegs{ std::move(pegs) }, m_hash{ hash }
+    {
+    }
+
+    [[nodiscard]] static bool legal(const container_type& table, id_type fromId, id_type toId)
+    {
+        return fromId != toId && fromId < table.size() && toId < table.size() && !table[fromId].empty()
+               && table[toId].placeable(table[fromId].top());
+    }
+
+    static void play(container_type& table, std::uint64_t& hash, id_type fromId, id_type toId)
+    {
+        const auto disk{ table[fromId].top() };
+        table[fromId].pop();
+        table[toId].push(disk);
+        hash ^= TheTowerOfHanoi::zobrist(disk, fromId) ^ TheTowerOfHanoi::zobrist(disk, toId);
+    }
+
+private:
+    std::shared_ptr<const container_type> m_pegs;
+    std::uint64_t m_hash{ 0 };
+};
+
+class HanoiJournal
+{
+public:
+    using entry_type = std::uint8_t;
+    using container_type = std::pmr::vector<entry_type>;
+    using allocator_type = container_type::allocator_type;
+    using size_type = container_type::size_type;
+
+    static constexpr unsigned peg_bits{ std::numeric_limits<entry_type>::digits / 2 };
+    static constexpr PegId max_pegs{ PegId{ 1 } << peg_bits };
+
+public:
+    HanoiJournal()
+            : m_entries{}
+    {
+    }
+
+    explicit HanoiJournal(const allocator_type& allocator)
+            : m_entries{ allocator }
+    {
+    }
+
+    HanoiJournal(container_type entries, size_type position)
+            : m_entries{ std::move(entries) }, m_cursor{ std::min(position, m_entries.size()) }
+    {
+    }
+
+    [[nodiscard]] static constexpr bool encodable(const HanoiMove& move)
+    {
+        return move.from < max_pegs && move.to < max_pegs;
+    }
+
+    [[nodiscard]] static constexpr entry_type encode(const HanoiMove& move)
+    {
+        return static_cast<entry_type>(move.from << peg_bits | move.to);
+    }
+
+    [[nodiscard]] static constexpr HanoiMove decode(entry_type entry)
+    {
+        return { .from = PegId{ entry } >> peg_bits, .to = PegId{ entry } & (max_pegs - 1) };
+    }
+
+    [[nodiscard]] size_type size() const
+    {
+        return m_entries.size();
+    }
+
+    [[nodiscard]] size_type position() const
+    {
+        return m_cursor;
+    }
+
+    [[nodiscard]] bool canUndo() const
+    {
+        return m_cursor > 0;
+    }
+
+    [[nodiscard]] bool canRedo() const
+    {
+        return m_cursor < m_entries.size();
+    }
+
+    [[nodiscard]] HanoiMove operator[](size_type index) const
+    {
+        return decode(m_entries[index]);
+    }
+
+    [[nodiscard]] const container_type& entries() const
+    {
+        return m_entries;
+    }
+
+    bool record(const HanoiMove& move)
+    {
+        if (!encodable(move))
+        {
+            return false;
+        }
+        m_entries.resize(m_cursor);
+        m_entries.push_back(encode(move));
+        ++m_cursor;
+        return true;
+    }
+
+    std::optional<HanoiMove> undo()
+    {
+        if (!canUndo())
+        {
+            return std::nullopt;
+        }
+        return decode(m_entries[--m_cursor]);
+    }
+
+    std::optional<HanoiMove> redo()
+    {
+        if (!canRedo())
+        {
+            return std::nullopt;
+        }
+        return decode(m_entries[m_cursor++]);
+    }
+
+    void clear()
+    {
+        m_entries.clear();
+        m_cursor = 0;
+    }
+
+    // Whether engine, taken as the position at the cursor, can undo every move before the cursor and then play the
+    // whole journal forward again; a journal that fails this would misplay undo or redo.
+    template<typename Engine>
+    [[nodiscard]] bool replays(Engine engine) const
+    {
+        for (auto index{ m_cursor }; index > 0; --index)
+        {
+            if (const auto move{ (*this)[index - 1] }; !engine.move(move.to, move.from))
+            {
+                return false;
+            }
+        }
+        for (size_type index{ 0 }; index < size(); ++index)
+        {
+            if (const auto move{ (*this)[index] }; !engine.move(move.from, move.to))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    container_type m_entries;
+    size_type m_cursor{ 0 };
+};
+
+class HanoiMappedFile
+{
+public:
+    HanoiMappedFile() = default;
+
+    explicit HanoiMappedFile(const char* path)
+    {
+        const auto fd{ ::open(path, O_RDONLY | O_CLOEXEC) };
+        if (fd < 0)
+        {
+            return;
+        }
+
+        struct stat info{};
+        if (::fstat(fd, &info) == 0 && info.st_size > 0)
+        {
+            if (auto* data{ ::mmap(nullptr, static_cast<std::size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0) };
+                    data != MAP_FAILED)
+            {
+                m_data = static_cast<const std::byte*>(data);
+                m_size = static_cast<std::size_t>(info.st_size);
+            }
+        }
+        ::close(fd);
+    }
+
+    HanoiMappedFile(HanoiMappedFile&& other) noexcept
+            : m_data{ std::exchange(other.m_data, nullptr) }, m_size{ std::exchange(other.m_size, 0) }
+    {
+    }
+
+    HanoiMappedFile& operator=(HanoiMappedFile&& other) noexcept
+    {
+        std::swap(m_data, other.m_data);
+        std::swap(m_size, other.m_size);
+        return *this;
+    }
+
+    ~HanoiMappedFile()
+    {
+        if (m_data != nullptr)
+        {
+            ::munmap(const_cast<std::byte*>(m_data), m_size);
+        }
+    }
+
+    [[nodiscard]] bool ok() const
+    {
+        return m_data != nullptr;
+    }
+
+    [[nodiscard]] std::span<const std::byte> bytes() const
+    {
+        return { m_data, m_size };
+    }
+
+private:
+    const std::byte* m_data{ nullptr };
+    std::size_t m_size{ 0 };
+};
+
+// Layout: header, one peg record per peg, then the name bytes, disk arrays (bottom to top) and journal entries at
+// the offsets the records give. All sections are 8-byte aligned so the disk arrays can be used in place.
+class HanoiSnapshot
+{
+public:
+    static constexpr std::array<char, 8> magic{ 'H', 'A', 'N', 'O', 'I', 'S', 'N', 'P' };
+    static constexpr std::uint32_t version{ 1 };
+    static constexpr std::size_t alignment{ 8 };
+
+    struct header_type
+    {
+        std::array<char, 8> magic;
+        std::uint32_t version;
+        std::uint32_t diskSize;
+        std::uint64_t pegCount;
+        std::uint64_t journalOffset;
+        std::uint64_t journalSize;
+        std::uint64_t journalPosition;
+    };
+
+    struct peg_record_type
+    {
+        std::uint64_t nameOffset;
+        std::uint64_t nameSize;
+        std::uint64_t disksOffset;
+        std::uint64_t diskCount;
+    };
+
+    template<typename Tower>
+    class View
+    {
+    public:
+        using tower_type = Tower;
+        using disk_type = tower_type::value_type;
+
+    public:
+        explicit View(HanoiMappedFile file)
+                : m_file{ std::move(file) }
+        {
+            m_ok = validate();
+        }
+
+        [[nodiscard]] bool ok() const
+        {
+            return m_ok;
+        }
+
+        [[nodiscard]] std::size_t size() const
+        {
+            return header().pegCount;
+        }
+
+        [[nodiscard]] std::string_view name(PegId id) const
+        {
+            const auto& record{ records()[id] };
+            return { reinterpret_cast<const char*>(base() + record.nameOffset), record.nameSize };
+        }
+
+        [[nodiscard]] std::span<const disk_type> disks(PegId id) const
+        {
+            const auto& record{ records()[id] };
+            return { reinterpret_cast<const disk_type*>(base() + record.disksOffset), record.diskCount };
+        }
+
+        [[nodiscard]] std::span<const HanoiJournal::entry_type> journal() const
+        {
+            return { reinterpret_cast<const HanoiJournal::entry_type*>(base() + header().journalOffset),
+                     header().journalSize };
+        }
+
+        [[nodiscard]] std::size_t journalPosition() const
+        {
+            return header().journalPosition;
+        }
+
+    private:
+        [[nodiscard]] const std::byte* base() const
+        {
+            return m_file.bytes().data();
+        }
+
+        [[nodiscard]] const header_type& header() const
+        {
+            return *reinterpret_cast<const header_type*>(base());
+        }
+
+        [[nodiscard]] std::span<const peg_record_type> records() const
+        {
+            return { reinterpret_cast<const peg_record_type*>(base() + sizeof(header_type)), header().pegCount };
+        }
+
+        [[nodiscard]] bool contains(std::uint64_t offset, std::uint64_t size) const
+        {
+            const auto total{ m_file.bytes().size() };
+            return offset <= total && size <= total - offset;
+        }
+
+        [[nodiscard]] bool validate() const
+        {
+            if (!m_file.ok() || !contains(0, sizeof(header_type)))
+            {
+                return false;
+            }
+
+            const auto& head{ header() };
+            if (head.magic != magic || head.version != version || head.diskSize != sizeof(disk_type)
+                || head.pegCount > m_file.bytes().size() / sizeof(peg_record_type)
+                || !contains(sizeof(header_type), head.pegCount * sizeof(peg_record_type))
+                || !contains(head.journalOffset, head.journalSize) || head.journalPosition > head.journalSize)
+            {
+                return false;
+            }
+
+            return std::ranges::all_of(records(), [this](const peg_record_type& record)
+            {
+                return contains(record.nameOffset, record.nameSize)
+                       && record.disksOffset % alignof(disk_type) == 0
+                       && record.diskCount <= m_file.bytes().size() / sizeof(disk_type)
+                       && contains(record.disksOffset, record.diskCount * sizeof(disk_type));
+            }) && std::ranges::all_of(std::views::iota(PegId{ 0 }, size()), [this](PegId id)
+            {
+                return stacked(disks(id));
+            }) && std::ranges::all_of(journal(), [this](HanoiJournal::entry_type entry)
+            {
+                const auto move{ HanoiJournal::decode(entry) };
+                return move.from < size() && move.to < size() && move.from != move.to;
+            });
+        }
+
+        // A saved peg is adopted as is, so it must already hold unique disks from the largest down, each of which
+        // the tower can represent.
+        [[nodiscard]] static bool stacked(std::span<const disk_type> pegDisks)
+        {
+            if (pegDisks.empty())
+            {
+                return true;
+            }
+            if (std::ranges::adjacent_find(pegDisks, std::less_equal{}) != pegDisks.end())
+            {
+                return false;
+            }
+            if constexpr (requires { { Tower::capacity } -> std::convertible_to<std::size_t>; })
+            {
+                return pegDisks.back() >= 1 && pegDisks.front() <= Tower::capacity;
+            }
+            else if constexpr (bounded_sequence<typename Tower::container_type>)
+            {
+                return pegDisks.size() <= Tower::container_type::capacity;
+            }
+            return true;
+        }
+
+    private:
+        HanoiMappedFile m_file;
+        bool m_ok{ false };
+    };
+
+public:
+    template<typename Tower, typename Allocator, typename Rules>
+    [[nodiscard]] static std::vector<std::byte> serialize(const BasicTowerOfHanoi<Tower, Allocator, Rules>& engine,
+                                                          const HanoiJournal* journal = nullptr)
+    {
+        using disk_type = Tower::value_type;
+        static_assert(std::is_trivially_copyable_v<disk_type>);
+
+        const auto pegCount{ engine.size() };
+        std::vector<peg_record_type> records(pegCount);
+        auto offset{ align(sizeof(header_type) + pegCount * sizeof(peg_record_type)) };
+        for (PegId id{ 0 }; id < pegCount; ++id)
+        {
+            records[id].nameOffset = offset;
+            records[id].nameSize = engine.name(id).size();
+            offset = align(offset + records[id].nameSize);
+        }
+        for (PegId id{ 0 }; id < pegCount; ++id)
+        {
+            records[id].disksOffset = offset;
+            records[id].diskCount = engine.select(id).size();
+            offset = align(offset + records[id].diskCount * sizeof(disk_type));
+        }
+
+        const header_type header{ .magic = magic,
+                                  .version = version,
+                                  .diskSize = sizeof(disk_type),
+                                  .pegCount = pegCount,
+                                  .journalOffset = offset,
+                                  .journalSize = journal ? journal->size() : 0,
+                                  .journalPosition = journal ? journal->position() : 0 };
+
+        std::vector<std::byte> image(offset + header.journalSize);
+        std::memcpy(image.data(), &header, sizeof(header));
+        std::ranges::copy(std::as_bytes(std::span{ records }), image.data() + sizeof(header));
+        for (PegId id{ 0 }; id < pegCount; ++id)
+        {
+            std::memcpy(image.data() + records[id].nameOffset, engine.name(id).data(), records[id].nameSize);
+
+            auto* disks{ image.data() + records[id].disksOffset };
+            engine.select(id).forEach([&disks](const disk_type& disk)
+                                      {
+                                          std::memcpy(disks, &disk, sizeof(disk));
+                                          disks += sizeof(disk);
+                                      });
+        }
+        if (journal)
+        {
+            std::ranges::copy(std::as_bytes(std::span{ journal->entries() }), image.data() + offset);
+        }
+        return image;
+    }
+
+    template<typename Tower, typename Allocator, typename Rules>
+    static bool save(const char* path, const BasicTowerOfHanoi<Tower, Allocator, Rules>& engine,
+                     const HanoiJournal* journal = nullptr)
+    {
+        const auto image{ serialize(engine, journal) };
+
+        const auto fd{ ::open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644) };
+        if (fd < 0)
+        {
+            return false;
+        }
+
+        std::size_t written{ 0 };
+        while (written < image.size())
+        {
+            const auto result{ ::write(fd, image.data() + written, image.size() - written) };
+            if (result < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (result <= 0)
+            {
+                break;
+            }
+            written += static_cast<std::size_t>(result);
+        }
+        return ::close(fd) == 0 && written == image.size();
+    }
+
+    template<typename Tower>
+    [[nodiscard]] static View<Tower> map(const char* path)
+    {
+        return View<Tower>{ HanoiMappedFile{ path }};
+    }
+
+    template<typename Tower, typename Allocator = std::allocator<std::byte>, typename Rules = HanoiClassicRules>
+    [[nodiscard]] static std::optional<BasicTowerOfHanoi<Tower, Allocator, Rules>>
+    restore(const View<Tower>& view, const Allocator& allocator = {})
+    {
+        if (!view.ok())
+        {
+            return std::nullopt;
+        }
+
+        // The view has checked every peg, so each is built in one pass and hashed once as it is added.
+        BasicTowerOfHanoi<Tower, Allocator, Rules> engine{ allocator };
+        engine.reserve(view.size());
+        for (PegId id{ 0 }; id < view.size(); ++id)
+        {
+            if (!engine.create(view.name(id), hanoi_sorted, view.disks(id)).ok)
+            {
+                return std::nullopt;
+            }
+        }
+        return engine;
+    }
+
+    template<typename Tower>
+    [[nodiscard]] static HanoiJournal restoreJournal(const View<Tower>& view)
+    {
+        if (!view.ok())
+        {
+            return {};
+        }
+        auto entries{ view.journal() };
+        return { { entries.begin(), entries.end() }, view.journalPosition() };
+    }
+
+private:
+    [[nodiscard]] static constexpr std::uint64_t align(std::uint64_t offset)
+    {
+        return (offset + alignment - 1) / alignment * alignment;
+    }
+};
+
+template<typename Engine>
+class HanoiRenderer
+{
+public:
+    using engine_type = Engine;
+    using tower_type = engine_type::tower_type;
+    using allocator_type = engine_type::allocator_type;
+    template<typename U>
+    using rebind_type = std::allocator_traits<allocator_type>::template rebind_alloc<U>;
+    using buffer_type = std::basic_string<char, std::char_traits<char>, rebind_type<char>>;
+
+    static constexpr std::size_t initial_frame_capacity{ 4096 };
+
+public:
+    HanoiRenderer()
+            : HanoiRenderer(allocator_type{})
+    {
+    }
+
+    explicit HanoiRenderer(const allocator_type& allocator)
+            : m_frame(allocator), m_scratch(allocator), m_message(allocator), m_lines(allocator), m_dirty(allocator)
+    {
+        m_frame.reserve(initial_frame_capacity);
+    }
+
+    void markDirty(PegId id)
+    {
+        if (id < m_dirty.size())
+        {
+            m_dirty[id] = true;
+        }
+    }
+
+    void invalidate()
+    {
+        m_full = true;
+    }
+
+    // Shown below the prompt by the next frame only, so a command's output, however many lines long, is erased
+    // by the frame after it.
+    void message(std::string_view text)
+    {
+        m_message.assign(text);
+    }
+
+    void render(const engine_type& engine, std::ostream& os)
+    {
+        m_frame.clear();
+
+        if (m_full || m_lines.size() != engine.size())
+        {
+            m_full = false;
+            m_lines.resize(engine.size());
+            m_dirty.assign(engine.size(), false);
+            m_frame += "\033[2J\033[1;1H";
+            for (PegId id{ 0 }; id < engine.size(); ++id)
+            {
+                formatLine(engine, id, m_lines[id]);
+                m_frame += m_lines[id];
+                m_frame += '\n';
+            }
+        }
+        else
+        {
+            for (PegId id{ 0 }; id < engine.size(); ++id)
+            {
+                if (!m_dirty[id])
+                {
+                    continue;
+                }
+                m_dirty[id] = false;
+
+                formatLine(engine, id, m_scratch);
+                if (m_scratch != m_lines[id])
+                {
+                    appendCursor(id + 1);
+                    m_frame += m_scratch;
+                    m_frame += "\033[K";
+                    std::swap(m_scratch, m_lines[id]);
+                }
+            }
+        }
+
+        appendCursor(engine.size() + 3);
+        m_frame += "\033[J";
+        m_frame += m_message;
+        m_message.clear();
+
+        appendCursor(engine.size() + 2);
+        m_frame += "\033[K";
+
+        os.write(m_frame.data(), static_cast<std::streamsize>(m_frame.size()));
+        os.flush();
+    }
+
+    static void formatLine(const engine_type& engine, PegId id, buffer_type& line)
+    {
+        line.assign(engine.name(id));
+        line += '#';
+        appendTower(engine.select(id), line);
+    }
+
+    static void appendTower(const tower_type& tower, buffer_type& line)
+    {
+        if constexpr (std::integral<typename tower_type::value_type> && requires { tower.container(); })
+        {
+            for (auto&& e: tower.container())
+            {
+                appendNumber(e, line);
+            }
+        }
+        else
+        {
+            std::ostringstream os;
+            os << tower;
+            line += os.view();
+        }
+    }
+
+private:
+    static void appendNumber(std::integral auto value, buffer_type& line)
+    {
+        std::array<char, std::numeric_limits<decltype(value)>::digits10 + 2> digits{};
+        auto [end, ec]{ std::to_chars(digits.data(), digits.data() + digits.size(), value) };
+        line.append(digits.data(), end);
+    }
+
+    void appendCursor(std::size_t row)
+    {
+        m_frame += "\033[";
+        appendNumber(row, m_frame);
+        m_frame += ";1H";
+    }
+
+private:
+    buffer_type m_frame;
+    buffer_type m_scratch;
+    buffer_type m_message;
+    std::vector<buffer_type, rebind_type<buffer_type>> m_lines;
+    std::vector<bool, rebind_type<bool>> m_dirty;
+    bool m_full{ true };
+};
+
+template<typename Allocator = std::allocator<char>>
+class HanoiStringBuffer : public std::streambuf
+{
+public:
+    using string_type = std::basic_string<char, std::char_traits<char>, Allocator>;
+
+public:
+    explicit HanoiStringBuffer(string_type& target)
+            : m_target{ target }
+    {
+    }
+
+protected:
+    std::streamsize xsputn(const char* data, std::streamsize count) override
+    {
+        m_target.append(data, static_cast<std::size_t>(count));
+        return count;
+    }
+
+    int_type overflow(int_type c) override
+    {
+        if (!traits_type::eq_int_type(c, traits_type::eof()))
+        {
+            m_target.push_back(traits_type::to_char_type(c));
+        }
+        return traits_type::not_eof(c);
+    }
+
+private:
+    string_type& m_target;
+};
+
+struct HanoiNextCommand
+{
+};
+
+inline constexpr HanoiNextCommand next_command{};
+
+// A game driven one command line at a time. co_yield publishes a frame without suspending; co_await next_command
+// is the only suspension point, and send() resumes it with the line.
+class HanoiGameLoop
+{
+public:
+    struct promise_type
+    {
+        std::string_view frame{};
+        std::string_view input{};
+        std::exception_ptr exception{};
+
+        HanoiGameLoop get_return_object()
+        {
+            return HanoiGameLoop{ std::coroutine_handle<promise_type>::from_promise(*this) };
+        }
+
+        std::suspend_never initial_suspend() noexcept
+        {
+            return {};
+        }
+
+        std::suspend_always final_suspend() noexcept
+        {
+            return {};
+        }
+
+        std::suspend_never yield_value(std::string_view value) noexcept
+        {
+            frame = value;
+            return {};
+        }
+
+        auto await_transform(HanoiNextCommand) noexcept
+        {
+            struct awaiter_type
+            {
+                promise_type& promise;
+
+                [[nodiscard]] bool await_ready() const noexcept
+                {
+                    return false;
+                }
+
+                void await_suspend(std::coroutine_handle<>) const noexcept
+                {
+                }
+
+                std::string_view await_resume() const noexcept
+                {
+                    return promise.input;
+                }
+            };
+            return awaiter_type{ *this };
+        }
+
+        void return_void() noexcept
+        {
+            frame = {};
+        }
+
+        void unhandled_exception() noexcept
+        {
+            exception = std::current_exception();
+        }
+    };
+
+    using handle_type = std::coroutine_handle<promise_type>;
+
+public:
+    HanoiGameLoop(HanoiGameLoop&& other) noexcept
+            : m_handle{ std::exchange(other.m_handle, nullptr) }
+    {
+    }
+
+    HanoiGameLoop& operator=(HanoiGameLoop&& other) noexcept
+    {
+        std::swap(m_handle, other.m_handle);
+        return *this;
+    }
+
+    ~HanoiGameLoop()
+    {
+        if (m_handle)
+        {
+            m_handle.destroy();
+        }
+    }
+
+    [[nodiscard]] bool done() const
+    {
+        return !m_handle || m_handle.done();
+    }
+
+    // The latest frame; it stays valid until the next send().
+    [[nodiscard]] std::string_view frame() const
+    {
+        return m_handle ? m_handle.promise().frame : std::string_view{};
+    }
+
+    // Hands one command line to the loop and runs it up to its next frame. The command only needs to outlive
+    // this call.
+    bool send(std::string_view command)
+    {
+        if (done())
+        {
+            return false;
+        }
+
+        auto& promise{ m_handle.promise() };
+        promise.input = command;
+        m_handle.resume();
+        if (promise.exception)
+        {
+            std::rethrow_exception(std::exchange(promise.exception, nullptr));
+        }
+        return !done();
+    }
+
+private:
+    explicit HanoiGameLoop(handle_type handle)
+            : m_handle{ handle }
+    {
+    }
+
+private:
+    handle_type m_handle;
+};
+
+// A starting or goal position written as text, one peg per blank-separated field: "a:9..1 b: c:" puts disks 9
+// down to 1 on peg a and leaves b and c empty. Disks are listed bottom to top as comma-separated numbers or
+// N..M runs, so a tower of ten million disks is a few bytes of layout and builds in one pass per peg.
+class HanoiLayout
+{
+public:
+    using allocator_type = std::pmr::polymorphic_allocator<std::byte>;
+    using disk_type = std::uint64_t;
+    using size_type = std::size_t;
+    struct run_type
+    {
+        disk_type first{ 0 };
+        disk_type last{ 0 };
+
+        [[nodiscard]] constexpr size_type size() const
+        {
+            return static_cast<size_type>(first - last + 1);
+        }
+    };
+
+    // Disks are named by value, so a short run such as "a:18446744073709551615..1" stands for more disks than any
+    // engine could hold; build() reserves for all of them up front, so fits() refuses layouts beyond this.
+    static constexpr size_type max_disks{ size_type{ 1 } << 28 };
+
+public:
+    HanoiLayout()
+            : HanoiLayout(allocator_type{})
+    {
+    }
+
+    explicit HanoiLayout(const allocator_type& allocator)
+            : m_names{ allocator }, m_pegs{ allocator }, m_runs{ allocator }
+    {
+    }
+
+    HanoiLayout(const HanoiLayout& other, const allocator_type& allocator)
+            : m_names{ other.m_names, allocator }, m_pegs{ other.m_pegs, allocator }, m_runs{ other.m_runs, allocator }
+    {
+    }
+
+    // Disks must be positive, descend along each peg and appear on one peg only; peg names must be unique.
+    [[nodiscard]] static std::optional<HanoiLayout> parse(std::string_view text, const allocator_type& allocator = {})
+    {
+        HanoiLayout layout{ allocator };
+        while (true)
+        {
+            const auto begin{ text.find_first_not_of(" \t") };
+            if (begin == std::string_view::npos)
+            {
+                break;
+            }
+            text.remove_prefix(begin);
+            const auto field{ text.substr(0, text.find_first_of(" \t")) };
+            text.remove_prefix(field.size());
+
+            const auto colon{ field.find(':') };
+            if (colon == 0 || colon == std::string_view::npos || !layout.addPeg(field.substr(0, colon)))
+            {
+                return std::nullopt;
+            }
+            for (auto disks{ field.substr(colon + 1) }; !disks.empty();)
+            {
+                const auto item{ disks.substr(0, disks.find(',')) };
+                disks.remove_prefix(std::min(item.size() + 1, disks.size()));
+                auto run{ parseRun(item) };
+                if (!run || !layout.addRun(*run))
+                {
+                    return std::nullopt;
+                }
+            }
+        }
+
+        if (!layout.disjoint())
+        {
+            return std::nullopt;
+        }
+        return layout;
+    }
+
+    // The classic start: disks down to 1 on peg "a" and the remaining pegs, named "b" onwards, empty.
+    [[nodiscard]] static HanoiLayout classic(disk_type disks, size_type pegs = 3, const allocator_type& allocator = {})
+    {
+        HanoiLayout layout{ allocator };
+        for (size_type peg{ 0 }; peg < std::min<size_type>(pegs, 26); ++peg)
+        {
+            const char name{ static_cast<char>('a' + peg) };
+            layout.addPeg({ &name, 1 });
+            if (peg == 0 && disks > 0)
+            {
+                layout.addRun({ .first = disks, .last = 1 });
+            }
+        }
+        return layout;
+    }
+
+    [[nodiscard]] size_type size() const
+    {
+        return m_pegs.size();
+    }
+
+    [[nodiscard]] std::string_view name(size_type peg) const
+    {
+        return std::string_view{ m_names }.substr(m_pegs[peg].name, m_pegs[peg].nameSize);
+    }
+
+    [[nodiscard]] std::span<const run_type> runs(size_type peg) const
+    {
+        return std::span{ m_runs }.subspan(m_pegs[peg].run, m_pegs[peg].runCount);
+    }
+
+    [[nodiscard]] size_type disks(size_type peg) const
+    {
+        size_type count{ 0 };
+        for (const auto& run: runs(peg))
+        {
+            count += run.size();
+        }
+        return count;
+    }
+
+    // The peg holding every disk, if the layout stacks them all on one.
+    [[nodiscard]] std::optional<size_type> target() const
+    {
+        std::optional<size_type> target{};
+        for (size_type peg{ 0 }; peg < size(); ++peg)
+        {
+            if (m_pegs[peg].runCount > 0)
+            {
+                if (target)
+                {
+                    return std::nullopt;
+                }
+                target = peg;
+            }
+        }
+        return target;
+    }
+
+    // Whether other names the same pegs and holds the same disks, which is what a game from this layout needs to
+    // be able to reach other.
+    [[nodiscard]] bool compatible(const HanoiLayout& other) const
+    {
+        if (size() != other.size())
+        {
+            return false;
+        }
+        for (size_type peg{ 0 }; peg < size(); ++peg)
+        {
+            if (!other.find(name(peg)))
+            {
+                return false;
+            }
+        }
+
+        const auto disks{ coalesced() };
+        const auto otherDisks{ other.coalesced() };
+        return std::ranges::equal(disks, otherDisks, [](const run_type& lhs, const run_type& rhs)
+        {
+            return lhs.first == rhs.first && lhs.last == rhs.last;
+        });
+    }
+
+    // Whether every disk is representable by Tower's disk type and, for bounded towers, within their capacity, and
+    // the layout holds no more than max_disks disks in all.
+    template<typename Tower>
+    [[nodiscard]] bool fits() const
+    {
+        using value_type = Tower::value_type;
+        size_type total{ 0 };
+        for (const auto& run: m_runs)
+        {
+            if (run.size() > max_disks - total)
+            {
+                return false;
+            }
+            total += run.size();
+        }
+        for (size_type peg{ 0 }; peg < size(); ++peg)
+        {
+            const auto pegRuns{ runs(peg) };
+            if (pegRuns.empty())
+            {
+                continue;
+            }
+            const auto largest{ pegRuns.front().first };
+            if constexpr (std::integral<value_type>)
+            {
+                if (largest > static_cast<disk_type>(std::numeric_limits<value_type>::max()))
+                {
+                    return false;
+                }
+            }
+            if constexpr (requires { { Tower::capacity } -> std::convertible_to<size_type>; })
+            {
+                if (largest > Tower::capacity)
+                {
+                    return false;
+                }
+            }
+            else if constexpr (bounded_sequence<typename Tower::container_type>)
+            {
+                if (disks(peg) > Tower::container_type::capacity)
+                {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    // Creates the pegs in order, each tower built in a single pass from its runs with no per-disk checks. Fails
+    // without touching engine when a disk does not fit the engine's towers.
+    template<typename Tower, typename Allocator, typename Rules>
+    bool build(BasicTowerOfHanoi<Tower, Allocator, Rules>& engine) const
+    {
+        using value_type = Tower::value_type;
+        if (!fits<Tower>())
+        {
+            return false;
+        }
+
+        bool ok{ true };
+        engine.reserve(engine.size() + size());
+        // Counted down from first by index, so a run topped by the largest disk_type never forms first + 1.
+        const auto disks{ [](const run_type& run)
+                          {
+                              return std::views::iota(size_type{ 0 }, run.size())
+                                     | std::views::transform([first = run.first](size_type index)
+                                                             {
+                                                                 return static_cast<value_type>(first - index);
+                                                             });
+                          } };
+        for (size_type peg{ 0 }; peg < size(); ++peg)
+        {
+            // A single run, the usual case, is a random-access range the tower can allocate and fill in one go.
+            if (const auto pegRuns{ runs(peg) }; pegRuns.empty())
+            {
+                ok &= engine.create(name(peg)).ok;
+            }
+            else if (pegRuns.size() == 1)
+            {
+                ok &= engine.create(name(peg), hanoi_sorted, disks(pegRuns.front())).ok;
+            }
+            else
+            {
+                auto joined{ pegRuns | std::views::transform(disks) | std::views::join };
+                const auto count{ static_cast<std::ptrdiff_t>(this->disks(peg)) };
+                ok &= engine.create(name(peg), hanoi_sorted, std::views::counted(joined.begin(), count)).ok;
+            }
+        }
+        return ok;
+    }
+
+    // Whether engine has exactly this layout: every named peg holds its runs and any other peg is empty.
+    template<typename Tower, typename Allocator, typename Rules>
+    [[nodiscard]] bool matches(const BasicTowerOfHanoi<Tower, Allocator, Rules>& engine) const
+    {
+        // Peg sizes settle most mismatches, so the disks themselves are only compared once every size agrees.
+        for (PegId id{ 0 }; id < engine.size(); ++id)
+        {
+            const auto peg{ find(engine.name(id)) };
+            if (engine.select(id).size() != (peg ? disks(*peg) : 0))
+            {
+                return false;
+            }
+        }
+
+        for (PegId id{ 0 }; id < engine.size(); ++id)
+        {
+            const auto& tower{ engine.select(id) };
+            const auto peg{ find(engine.name(id)) };
+            if (!peg)
+            {
+                continue;
+            }
+
+            bool same{ true };
+            auto run{ runs(*peg).begin() };
+            auto next{ run == runs(*peg).end() ? disk_type{ 0 } : run->first };
+            tower.forEach([&](const auto& disk)
+                          {
+                              same = same && static_cast<disk_type>(disk) == next;
+                              if (next == run->last && ++run != runs(*peg).end())
+                              {
+                                  next = run->first;
+                              }
+                              else
+                              {
+                                  --next;
+                              }
+                          });
+            if (!same)
+            {
+                return false;
+            }
+        }
+
+        for (size_type peg{ 0 }; peg < size(); ++peg)
+        {
+            if (m_pegs[peg].runCount > 0 && !engine.has(name(peg)))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    struct peg_type
+    {
+        size_type name{ 0 };
+        size_type nameSize{ 0 };
+        size_type run{ 0 };
+        size_type runCount{ 0 };
+    };
+
+    [[nodiscard]] static std::optional<run_type> parseRun(std::string_view item)
+    {
+        const auto number{ [](std::string_view digits) -> std::optional<disk_type>
+                           {
+                               disk_type value{ 0 };
+                               const auto [end, error]{ std::from_chars(digits.data(), digits.data() + digits.size(),
+                                                                        value) };
+                               if (error != std::errc{} || end != digits.data() + digits.size() || value == 0)
+                               {
+                                   return std::nullopt;
+                               }
+                               return value;
+                           } };
+
+        const auto dots{ item.find("..") };
+        const auto first{ number(item.substr(0, dots)) };
+        const auto last{ dots == std::string_view::npos ? first : number(item.substr(dots + 2)) };
+        if (!first || !last || *first < *last)
+        {
+            return std::nullopt;
+        }
+        return run_type{ .first = *first, .last = *last };
+    }
+
+    [[nodiscard]] std::optional<size_type> find(std::string_view name) const
+    {
+        for (size_type peg{ 0 }; peg < size(); ++peg)
+        {
+            if (this->name(peg) == name)
+            {
+                return peg;
+            }
+        }
+        return std::nullopt;
+    }
+
+    bool addPeg(std::string_view name)
+    {
+        if (find(name))
+        {
+            return false;
+        }
+        m_pegs.push_back({ .name = m_names.size(), .nameSize = name.size(), .run = m_runs.size() });
+        m_names.append(name);
+        return true;
+    }
+
+    // Runs arrive bottom to top, so each must start below where the previous one on the peg ended.
+    bool addRun(const run_type& run)
+    {
+        auto& peg{ m_pegs.back() };
+        if (peg.runCount > 0 && m_runs.back().last <= run.first)
+        {
+            return false;
+        }
+        if (peg.runCount > 0 && m_runs.back().last == run.first + 1)
+        {
+            m_runs.back().last = run.last;
+            return true;
+        }
+        m_runs.push_back(run);
+        ++peg.runCount;
+        return true;
+    }
+
+    // Every disk of the layout as the fewest runs, ordered from the smallest disk up; disjoint() must hold.
+    [[nodiscard]] std::pmr::vector<run_type> coalesced() const
+    {
+        std::pmr::vector<run_type> sorted{ m_runs, m_runs.get_allocator() };
+        std::ranges::sort(sorted, {}, &run_type::last);
+        std::pmr::vector<run_type> merged{ m_runs.get_allocator() };
+        for (const auto& run: sorted)
+        {
+            if (!merged.empty() && merged.back().first + 1 == run.last)
+            {
+                merged.back().first = run.first;
+            }
+            else
+            {
+                merged.push_back(run);
+            }
+        }
+        return merged;
+    }
+
+    // No disk may sit on two pegs: sorted by their top disk, the runs must not overlap.
+    [[nodiscard]] bool disjoint() const
+    {
+        std::pmr::vector<run_type> sorted{ m_runs, m_runs.get_allocator() };
+        std::ranges::sort(sorted, {}, &run_type::last);
+        for (size_type i{ 1 }; i < sorted.size(); ++i)
+        {
+            if (sorted[i].last <= sorted[i - 1].first)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    std::pmr::string m_names;
+    std::pmr::vector<peg_type> m_pegs;
+    std::pmr::vector<run_type> m_runs;
+};
+
+class TheTowerOfHanoiGame
+{
+public:
+    using engine_type = PmrTowerOfHanoi;
+    using allocator_type = engine_type::allocator_type;
+
+    static constexpr std::size_t stream_block_size{ std::size_t{ 1 } << 16 };
+
+    enum class command_type
+    {
+        nop,
+        move,
+        undo,
+        redo,
+        render,
+        stats,
+        hint,
+        quit
+    };
+    struct parse_result_type
+    {
+        bool ok{ false };
+        command_type type{ command_type::nop };
+        std::string_view from{};
+        std::string_view to{};
+        std::string_view moves{};
+    };
+
+    // A line is either a /command or a whitespace-separated list of from,to moves such as "a,c b,c a,b", starting
+    // with a move; from and to hold that first move and moves the rest of the list. Commands are told apart by a
+    // switch on their first letter (and their length for /redo and /render) and confirmed with one comparison.
+    static parse_result_type parse(std::string_view input)
+    {
+        if (input.starts_with('/'))
+        {
+            return { .ok = true, .type = command(input.substr(1)) };
+        }
+
+        parse_result_type result{ .moves = input };
+        if (nextMove(result.moves, result.from, result.to))
+        {
+            result.ok = true;
+            result.type = command_type::move;
+        }
+        return result;
+    }
+
+    // Splits the next from,to token off the front of moves, skipping blanks around it.
+    static bool nextMove(std::string_view& moves, std::string_view& from, std::string_view& to)
+    {
+        const auto blank{ [](char c) { return c == ' ' || c == '\t'; } };
+        std::size_t begin{ 0 };
+        while (begin < moves.size() && blank(moves[begin]))
+        {
+            ++begin;
+        }
+
+        auto comma{ std::string_view::npos };
+        auto end{ begin };
+        for (; end < moves.size() && !blank(moves[end]); ++end)
+        {
+            if (moves[end] == ',' && comma == std::string_view::npos)
+            {
+                comma = end;
+            }
+        }
+
+        const auto token{ moves.substr(begin, end - begin) };
+        moves.remove_prefix(end);
+        if (comma == std::string_view::npos)
+        {
+            return false;
+        }
+        from = token.substr(0, comma - begin);
+        to = token.substr(comma - begin + 1);
+        return true;
+    }
+
+public:
+    TheTowerOfHanoiGame()
+            : TheTowerOfHanoiGame(allocator_type{})
+    {
+    }
+
+    // Every allocation the game makes (pegs, names, journal, frame buffers) comes from the allocator's resource,
+    // so a game built on a monotonic arena is torn down by releasing the arena.
+    explicit TheTowerOfHanoiGame(const allocator_type& allocator)
+            : m_engine{ allocator },
+              m_renderer{ allocator },
+              m_input{ allocator },
+              m_journal{ allocator }
+    {
+        indexPegs();
+    }
+
+    explicit TheTowerOfHanoiGame(engine_type::mapped_type::size_type initial, const allocator_type& allocator = {})
+            : TheTowerOfHanoiGame(allocator)
+    {
+        if (!HanoiLayout::classic(initial, 3, allocator).build(m_engine))
+        {
+            throw std::length_error{ "TheTowerOfHanoiGame: too many disks" };
+        }
+        indexPegs();
+    }
+
+    // A game starting from start, or nothing if start does not fit the engine's disk type or has more pegs than
+    // the journal can name.
+    [[nodiscard]] static std::optional<TheTowerOfHanoiGame> from(const HanoiLayout& start,
+                                                                 const allocator_type& allocator = {})
+    {
+        std::optional<TheTowerOfHanoiGame> game{ std::in_place, allocator };
+        if (!start.build(game->m_engine) || !journaled(game->m_engine))
+        {
+            return std::nullopt;
+        }
+        game->indexPegs();
+        return game;
+    }
+
+    // Plays from start until the pegs match goal, then stops with a "solved" line; hints are offered when the
+    // goal stacks every disk on one peg. A goal with other pegs or other disks than start could never be reached.
+    [[nodiscard]] static std::optional<TheTowerOfHanoiGame> from(const HanoiLayout& start, const HanoiLayout& goal,
+                                                                 const allocator_type& allocator = {})
+    {
+        if (!start.compatible(goal) || !goal.fits<engine_type::tower_type>())
+        {
+            return std::nullopt;
+        }
+        auto game{ from(start, allocator) };
+        if (game)
+        {
+            game->m_goal.emplace(goal, allocator);
+        }
+        return game;
+    }
+
+    explicit TheTowerOfHanoiGame(engine_type engine)
+            : m_engine(std::move(engine)),
+              m_renderer{ m_engine.get_allocator() },
+              m_input{ m_engine.get_allocator() },
+              m_journal{ m_engine.get_allocator() }
+    {
+        if (!journaled(m_engine))
+        {
+            throw std::length_error{ "TheTowerOfHanoiGame: too many pegs" };
+        }
+        indexPegs();
+    }
+
+    [[nodiscard]] const engine_type& engine() const
+    {
+        return m_engine;
+    }
+
+    [[nodiscard]] const HanoiJournal& journal() const
+    {
+        return m_journal;
+    }
+
+    // Without a goal layout the game is solved once every disk sits on the last peg.
+    [[nodiscard]] bool solved() const
+    {
+        if (m_goal)
+        {
+            return m_goal->matches(m_engine);
+        }
+        for (PegId id{ 0 }; id + 1 < m_engine.size(); ++id)
+        {
+            if (!m_engine.select(id).empty())
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool save(const char* path) const
+    {
+        return HanoiSnapshot::save(path, m_engine, &m_journal);
+    }
+
+    bool load(const char* path)
+    {
+        auto view{ HanoiSnapshot::map<engine_type::tower_type>(path) };
+        auto engine{ HanoiSnapshot::restore(view, m_engine.get_allocator()) };
+        if (!engine || !journaled(*engine))
+        {
+            return false;
+        }
+        auto journal{ HanoiSnapshot::restoreJournal(view) };
+        if (!journal.replays(*engine))
+        {
+            return false;
+        }
+        m_engine = std::move(*engine);
+        m_journal = std::move(journal);
+        m_renderer.invalidate();
+        indexPegs();
+        return true;
+    }
+
+    void start()
+    {
+        m_running = true;
+    }
+
+    [[nodiscard]] bool running() const
+    {
+        return m_running;
+    }
+
+    // Command output goes to the renderer rather than straight to the terminal, which the incremental frames
+    // would otherwise leave behind under the prompt.
+    void run()
+    {
+        start();
+
+        std::string output{};
+        HanoiStringBuffer buffer{ output };
+        std::ostream os{ &buffer };
+        while (m_running)
+        {
+            {
+                HanoiScopedTimer timer{ HanoiTimer::render };
+                HanoiTraceSpan span{ HanoiEvent::render };
+                m_renderer.render(m_engine, std::cout);
+            }
+
+            std::getline(std::cin, m_input, '\n');
+
+            if (std::cin.eof() && m_input.empty())
+            {
+                break;
+            }
+            if (std::cin.fail())
+            {
+                std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+                std::cin.clear();
+                continue;
+            }
+
+            output.clear();
+            execute(m_input, os);
+            m_renderer.message(output);
+        }
+
+        if (reachedGoal())
+        {
+            {
+                HanoiScopedTimer timer{ HanoiTimer::render };
+                HanoiTraceSpan span{ HanoiEvent::render };
+                m_renderer.render(m_engine, std::cout);
+            }
+            std::cout << "solved" << std::endl;
+        }
+    }
+
+    HanoiGameLoop play()
+    {
+        start();
+
+        std::string frame{};
+        HanoiStringBuffer buffer{ frame };
+        std::ostream os{ &buffer };
+        while (m_running)
+        {
+            os << m_engine << '\n';
+            co_yield frame;
+
+            auto input{ co_await next_command };
+            frame.clear();
+            execute(input, os);
+        }
+
+        // The frame lives in this coroutine, so the solved frame is held until one more send() ends the loop.
+        if (reachedGoal())
+        {
+            os << m_engine << '\n' << "solved\n";
+            co_yield frame;
+            co_await next_command;
+        }
+    }
+
+    void stream(std::istream& is, std::ostream& os)
+    {
+        start();
+        m_input.resize(stream_block_size);
+
+        std::size_t carry{ 0 };
+        while (m_running && is)
+        {
+            if (carry == m_input.size())
+            {
+                m_input.resize(m_input.size() * 2);
+            }
+
+            is.read(m_input.data() + carry, static_cast<std::streamsize>(m_input.size() - carry));
+            std::string_view pending{ m_input.data(), carry + static_cast<std::size_t>(is.gcount()) };
+
+            for (auto pos{ pending.find('\n') }; m_running && pos != std::string_view::npos; pos = pending.find('\n'))
+            {
+                execute(pending.substr(0, pos), os);
+                pending.remove_prefix(pos + 1);
+            }
+
+            carry = pending.size();
+            std::ranges::copy(pending, m_input.begin());
+        }
+
+        if (m_running && carry > 0)
+        {
+            execute({ m_input.data(), carry }, os);
+        }
+
+        {
+            HanoiScopedTimer timer{ HanoiTimer::render };
+            HanoiTraceSpan span{ HanoiEvent::render };
+            os << m_engine << '\n';
+        }
+        if (reachedGoal())
+        {
+            os << "solved\n";
+        }
+        os.flush();
+    }
+
+    void execute(std::string_view input, std::ostream& os)
+    {
+        if (input.ends_with('\r'))
+        {
+            input.remove_suffix(1);
+        }
+
+        parse_result_type result{};
+        {
+            HanoiScopedTimer timer{ HanoiTimer::parse };
+            HanoiTraceSpan span{ HanoiEvent::parse, input.size() };
+            result = parse(input);
+        }
+
+        if (result.ok)
+        {
+            switch (result.type)
+            {
+                case command_type::quit:
+                    m_running = false;
+                    break;
+                case command_type::move:
+                    playMoves(result);
+                    checkGoal();
+                    break;
+                case command_type::undo:
+                    if (m_journal.canUndo())
+                    {
+                        if (const auto move{ m_journal[m_journal.position() - 1] }; m_engine.move(move.to, move.from))
+                        {
+                            m_journal.undo();
+                            markDirty(move);
+                            HanoiTrace::instant(HanoiEvent::undo, move.to, move.from);
+                            checkGoal();
+                        }
+                    }
+                    break;
+                case command_type::redo:
+                    if (m_journal.canRedo())
+                    {
+                        if (const auto move{ m_journal[m_journal.position()] }; m_engine.move(move.from, move.to))
+                        {
+                            m_journal.redo();
+                            markDirty(move);
+                            HanoiTrace::instant(HanoiEvent::redo, move.from, move.to);
+                            checkGoal();
+                        }
+                    }
+                    break;
+                case command_type::render:
+                {
+                    HanoiScopedTimer timer{ HanoiTimer::render };
+                    HanoiTraceSpan span{ HanoiEvent::render };
+                    os << m_engine << '\n';
+                    break;
+                }
+                case command_type::stats:
+                    os << HanoiStats::snapshot();
+                    break;
+                case command_type::hint:
+                    hint(os);
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+
+private:
+    static constexpr PegId no_handle{ std::numeric_limits<PegId>::max() };
+
+    [[nodiscard]] static constexpr command_type command(std::string_view name)
+    {
+        const auto match{ [name](std::string_view command, command_type type)
+                          {
+                              return name == command ? type : command_type::nop;
+                          } };
+        switch (name.empty() ? '\0' : name.front())
+        {
+            case 'q':
+                return match("quit", command_type::quit);
+            case 'u':
+                return match("undo", command_type::undo);
+            case 'r':
+                return name.size() == 4 ? match("redo", command_type::redo) : match("render", command_type::render);
+            case 's':
+                return match("stats", command_type::stats);
+            case 'h':
+                return match("hint", command_type::hint);
+            default:
+                return command_type::nop;
+        }
+    }
+
+    // Every move the game plays is journaled, so it never holds a peg the journal cannot name.
+    [[nodiscard]] static bool journaled(const engine_type& engine)
+    {
+        return engine.size() <= HanoiJournal::max_pegs;
+    }
+
+    // Single-letter peg names, the only kind the game creates, resolve through a table instead of a name scan.
+    void indexPegs()
+    {
+        m_handles.fill(no_handle);
+        for (PegId id{ 0 }; id < m_engine.size(); ++id)
+        {
+            if (const auto name{ m_engine.name(id) }; name.size() == 1)
+            {
+                m_handles[static_cast<unsigned char>(name.front())] = id;
+            }
+        }
+    }
+
+    [[nodiscard]] std::optional<PegId> handle(std::string_view name) const
+    {
+        if (name.size() == 1)
+        {
+            if (const auto id{ m_handles[static_cast<unsigned char>(name.front())] }; id != no_handle)
+            {
+                return id;
+            }
+        }
+        return m_engine.resolve(name);
+    }
+
+    // Plays every move of a parsed line in order. Moves naming unknown pegs and illegal moves are skipped.
+    void playMoves(const parse_result_type& result)
+    {
+        auto from{ result.from };
+        auto to{ result.to };
+        auto moves{ result.moves };
+        for (bool more{ true }; more;)
+        {
+            if (auto fromId{ handle(from) }, toId{ handle(to) }; fromId && toId && *fromId != *toId)
+            {
+                if (const HanoiMove move{ .from = *fromId, .to = *toId }; m_engine.move(move.from, move.to))
+                {
+                    markDirty(move);
+                    m_journal.record(move);
+                }
+            }
+
+            more = false;
+            while (!more && !moves.empty())
+            {
+                more = nextMove(moves, from, to);
+            }
+        }
+    }
+
+    [[nodiscard]] std::optional<PegId> target() const
+    {
+        if (!m_goal)
+        {
+            return m_engine.size() == 0 ? std::nullopt : std::optional<PegId>{ m_engine.size() - 1 };
+        }
+        const auto peg{ m_goal->target() };
+        return peg ? m_engine.resolve(m_goal->name(*peg)) : std::nullopt;
+    }
+
+    void hint(std::ostream& os) const
+    {
+        const auto target{ this->target() };
+        auto distance{ target ? HanoiAnalysis::distance(m_engine, *target) : std::nullopt };
+        if (!distance)
+        {
+            os << "hint: unavailable\n";
+            return;
+        }
+
+        os << "hint: " << *distance << " moves left";
+        if (auto move{ HanoiAnalysis::nextMove(m_engine, *target) })
+        {
+            os << ", next " << m_engine.name(move->from) << ',' << m_engine.name(move->to);
+        }
+        os << '\n';
+    }
+
+    // Ends run(), stream() and play() once a game with a goal layout reaches it; each loop then shows the final
+    // position followed by a "solved" line.
+    void checkGoal()
+    {
+        if (reachedGoal())
+        {
+            m_running = false;
+        }
+    }
+
+    [[nodiscard]] bool reachedGoal() const
+    {
+        return m_goal && m_goal->matches(m_engine);
+    }
+
+    void markDirty(const HanoiMove& move)
+    {
+        m_renderer.markDirty(move.from);
+        m_renderer.markDirty(move.to);
+    }
+
+private:
+    engine_type m_engine;
+    HanoiRenderer<engine_type> m_renderer{};
+    bool m_running{ false };
+    std::pmr::string m_input{};
+    HanoiJournal m_journal{};
+    std::array<PegId, 256> m_handles{};
+    std::optional<HanoiLayout> m_goal{};
+};
+
+// A recorded line of play: a starting position and the journal of moves made from it. Keyframes hold the peg
+// of every disk at regular intervals, so seeking restores the nearest earlier keyframe and replays at most one
+// interval of moves rather than the whole recording.
+class HanoiReplay
+{
+public:
+    using engine_type = TheTowerOfHanoiGame::engine_type;
+    using size_type = std::size_t;
+    using keyframe_type = std::uint8_t;
+
+    static constexpr size_type default_keyframe_interval{ 4096 };
+    static constexpr size_type decode_block_size{ 1024 };
+
+public:
+    // Requires the disks of start to be exactly 1..n and every recorded move to be legal.
+    [[nodiscard]] static std::optional<HanoiReplay> record(const engine_type& start, HanoiJournal moves,
+                                                           size_type interval = default_keyframe_interval)
+    {
+        auto pegOfDisk{ HanoiStateCodec::assignment(start) };
+        if (!pegOfDisk || start.size() > std::numeric_limits<keyframe_type>::max() + size_type{ 1 })
+        {
+            return std::nullopt;
+        }
+
+        HanoiReplay replay{ start, std::move(moves), std::max<size_type>(interval, 1), pegOfDisk->size() };
+        auto engine{ start };
+        for (size_type index{ 0 }; index < replay.size(); ++index)
+        {
+            if (index % replay.m_interval == 0)
+            {
+                replay.keyframe(engine);
+            }
+            const auto move{ replay.m_moves[index] };
+            if (move.from == move.to || !engine.move(move.from, move.to))
+            {
+                return std::nullopt;
+            }
+        }
+        if (replay.size() % replay.m_interval == 0)
+        {
+            replay.keyframe(engine);
+        }
+        replay.m_engine = start;
+        return replay;
+    }
+
+    // Records the moves a game has played so far, starting from the position before the first of them; nullopt as
+    // soon as one of those moves cannot be taken back.
+    [[nodiscard]] static std::optional<HanoiReplay> record(const TheTowerOfHanoiGame& game,
+                                                           size_type interval = default_keyframe_interval)
+    {
+        const auto& journal{ game.journal() };
+        auto start{ game.engine() };
+        for (auto index{ journal.position() }; index > 0; --index)
+        {
+            if (const auto move{ journal[index - 1] }; !start.move(move.to, move.from))
+            {
+                return std::nullopt;
+            }
+        }
+
+        HanoiJournal::container_type entries(journal.entries().begin(),
+                                             journal.entries().begin()
+                                             + static_cast<std::ptrdiff_t>(journal.position()));
+        const auto count{ entries.size() };
+        return record(start, HanoiJournal{ std::move(entries), count }, interval);
+    }
+
+    [[nodiscard]] size_type size() const
+    {
+        return m_moves.size();
+    }
+
+    [[nodiscard]] size_type cursor() const
+    {
+        return m_cursor;
+    }
+
+    [[nodiscard]] size_type keyframes() const
+    {
+        return m_disks == 0 ? 0 : m_keyframes.size() / m_disks;
+    }
+
+    [[nodiscard]] const engine_type& engine() const
+    {
+        return m_engine;
+    }
+
+    [[nodiscard]] const HanoiJournal& moves() const
+    {
+        return m_moves;
+    }
+
+    // Moves the cursor to just after the first index moves: the keyframe at or before index, then the rest.
+    void seek(size_type index)
+    {
+        index = std::min(index, size());
+        if (index < m_cursor || index - m_cursor > index % m_interval)
+        {
+            restore(index / m_interval);
+        }
+        forward(index - m_cursor);
+    }
+
+    bool step()
+    {
+        if (m_cursor == size())
+        {
+            return false;
+        }
+        forward(1);
+        return true;
+    }
+
+    // Plays from the cursor to the end at movesPerSecond, rendering every move; zero plays at full speed and
+    // renders only the final position.
+    void play(std::ostream& os, double movesPerSecond = 0)
+    {
+        HanoiRenderer<engine_type> renderer{ m_engine.get_allocator() };
+        if (movesPerSecond <= 0)
+        {
+            forward(size() - m_cursor);
+            renderer.render(m_engine, os);
+            return;
+        }
+
+        const std::chrono::duration<double> period{ 1 / movesPerSecond };
+        const auto start{ std::chrono::steady_clock::now() };
+        renderer.render(m_engine, os);
+        for (std::size_t frame{ 1 }; m_cursor < size(); ++frame)
+        {
+            const auto move{ m_moves[m_cursor] };
+            forward(1);
+            renderer.markDirty(move.from);
+            renderer.markDirty(move.to);
+            std::this_thread::sleep_until(start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                    period * static_cast<double>(frame)));
+            renderer.render(m_engine, os);
+        }
+    }
+
+private:
+    HanoiReplay(const engine_type& start, HanoiJournal moves, size_type interval, size_type disks)
+            : m_engine{ start }, m_moves{ std::move(moves) }, m_interval{ interval }, m_disks{ disks }
+    {
+        m_keyframes.reserve((size() / m_interval + 1) * m_disks);
+    }
+
+    void keyframe(const engine_type& engine)
+    {
+        const auto offset{ m_keyframes.size() };
+        m_keyframes.resize(offset + m_disks);
+        for (PegId id{ 0 }; id < engine.size(); ++id)
+        {
+            engine.select(id).forEach([this, offset, id](const auto& disk)
+                                      {
+                                          m_keyframes[offset + static_cast<size_type>(disk) - 1] =
+                                                  static_cast<keyframe_type>(id);
+                                      });
+        }
+    }
+
+    void restore(size_type keyframe)
+    {
+        engine_type engine{ m_engine.get_allocator() };
+        for (PegId id{ 0 }; id < m_engine.size(); ++id)
+        {
+            engine.create(m_engine.name(id));
+        }
+        const auto* pegOfDisk{ m_keyframes.data() + keyframe * m_disks };
+        for (auto disk{ m_disks }; disk > 0; --disk)
+        {
+            engine.select(PegId{ pegOfDisk[disk - 1] }).push(static_cast<engine_type::tower_type::value_type>(disk));
+        }
+        engine.rehash();
+        m_engine = std::move(engine);
+        m_cursor = keyframe * m_interval;
+    }
+
+    // Recorded moves were validated when the replay was built, so they are decoded in blocks and applied in bulk.
+    void forward(size_type count)
+    {
+        std::array<HanoiMove, decode_block_size> block{};
+        while (count > 0)
+        {
+            const auto size{ std::min(count, block.size()) };
+            for (size_type i{ 0 }; i < size; ++i)
+            {
+                block[i] = m_moves[m_cursor + i];
+            }
+            m_engine.apply(std::span{ block }.first(size));
+            m_cursor += size;
+            count -= size;
+        }
+    }
+
+private:
+    engine_type m_engine;
+    HanoiJournal m_moves;
+    size_type m_interval;
+    size_type m_disks;
+    std::vector<keyframe_type> m_keyframes{};
+    size_type m_cursor{ 0 };
+};
+
+class HanoiSessionHost
+{
+public:
+    using game_type = TheTowerOfHanoiGame;
+    using size_type = std::size_t;
+
+    static constexpr size_type read_block_size{ 4096 };
+    static constexpr size_type session_arena_size{ 16384 };
+    // A session is closed once it holds an unterminated line or unsent output beyond these.
+    static constexpr size_type max_line_size{ 4096 };
+    static constexpr size_type max_output_size{ size_type{ 1 } << 20 };
+    static constexpr int max_events{ 64 };
+
+public:
+    HanoiSessionHost(std::uint16_t port, size_type threads, game_type::engine_type::mapped_type::size_type disks)
+            : m_disks{ disks },
+              m_workerCount{ std::max<size_type>(threads, 1) },
+              m_workers{ std::make_unique<worker_type[]>(m_workerCount) }
+    {
+        m_listen = ::socket(AF_INET6, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        m_wake = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (m_listen < 0 || m_wake < 0)
+        {
+            return;
+        }
+
+        const int yes{ 1 };
+        const int no{ 0 };
+        ::setsockopt(m_listen, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+        ::setsockopt(m_listen, IPPROTO_IPV6, IPV6_V6ONLY, &no, sizeof(no));
+
+        sockaddr_in6 address{};
+        address.sin6_family = AF_INET6;
+        address.sin6_addr = in6addr_any;
+        address.sin6_port = htons(port);
+        if (::bind(m_listen, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0
+            || ::listen(m_listen, SOMAXCONN) != 0)
+        {
+            return;
+        }
+
+        for (size_type index{ 0 }; index < m_workerCount; ++index)
+        {
+            auto& worker{ m_workers[index] };
+            worker.epoll = ::epoll_create1(EPOLL_CLOEXEC);
+            if (worker.epoll < 0
+                || !watch(worker.epoll, m_listen, &m_listen, EPOLLIN | EPOLLEXCLUSIVE, EPOLL_CTL_ADD)
+                || !watch(worker.epoll, m_wake, &m_wake, EPOLLIN, EPOLL_CTL_ADD))
+            {
+                return;
+            }
+        }
+
+        for (size_type index{ 0 }; index < m_workerCount; ++index)
+        {
+            m_workers[index].thread = std::jthread{ [this, index]
+                                                    {
+                                                        serve(m_workers[index]);
+                                                    }};
+        }
+        m_ok = true;
+    }
+
+    HanoiSessionHost(const HanoiSessionHost&) = delete;
+    HanoiSessionHost& operator=(const HanoiSessionHost&) = delete;
+
+    ~HanoiSessionHost()
+    {
+        stop();
+        for (size_type index{ 0 }; index < m_workerCount; ++index)
+        {
+            auto& worker{ m_workers[index] };
+            if (worker.thread.joinable())
+            {
+                worker.thread.join();
+            }
+            if (worker.epoll >= 0)
+            {
+                ::close(worker.epoll);
+            }
+        }
+        if (m_listen >= 0)
+        {
+            ::close(m_listen);
+        }
+        if (m_wake >= 0)
+        {
+            ::close(m_wake);
+        }
+    }
+
+    [[nodiscard]] bool ok() const
+    {
+        return m_ok;
+    }
+
+    [[nodiscard]] std::uint16_t port() const
+    {
+        sockaddr_in6 address{};
+        socklen_t length{ sizeof(address) };
+        if (::getsockname(m_listen, reinterpret_cast<sockaddr*>(&address), &length) != 0)
+        {
+            return 0;
+        }
+        return ntohs(address.sin6_port);
+    }
+
+    [[nodiscard]] size_type sessions() const
+    {
+        return m_sessions.load(std::memory_order_relaxed);
+    }
+
+    void stop()
+    {
+        if (m_wake >= 0)
+        {
+            const std::uint64_t one{ 1 };
+            [[maybe_unused]] auto result{ ::write(m_wake, &one, sizeof(one)) };
+        }
+    }
+
+    void wait()
+    {
+        for (size_type index{ 0 }; index < m_workerCount; ++index)
+        {
+            if (m_workers[index].thread.joinable())
+            {
+                m_workers[index].thread.join();
+            }
+        }
+    }
+
+private:
+    struct session_type
+    {
+        session_type(int socket, game_type::engine_type::mapped_type::size_type disks,
+                     std::pmr::memory_resource* upstream)
+                : fd{ socket }, arena{ storage.data(), storage.size(), upstream }, game{ disks, &arena }
+        {
+            game.start();
+        }
+
+        int fd;
+        size_type slot{ 0 };
+        bool writable{ true };
+        std::array<std::byte, session_arena_size> storage;
+        std::pmr::monotonic_buffer_resource arena;
+        game_type game;
+        std::pmr::string input{ &arena };
+        std::pmr::string output{ &arena };
+        HanoiStringBuffer<std::pmr::polymorphic_allocator<char>> buffer{ output };
+        std::ostream os{ &buffer };
+    };
+
+    struct worker_type
+    {
+        int epoll{ -1 };
+        std::pmr::unsynchronized_pool_resource arena{};
+        std::vector<session_type*> sessions{};
+        std::jthread thread{};
+    };
+
+    static bool watch(int epoll, int fd, void* tag, std::uint32_t events, int operation)
+    {
+        epoll_event event{};
+        event.events = events;
+        event.data.ptr = tag;
+        return ::epoll_ctl(epoll, operation, fd, &event) == 0;
+    }
+
+    void serve(worker_type& worker)
+    {
+        std::array<epoll_event, max_events> events{};
+        bool stopping{ false };
+        while (!stopping)
+        {
+            const auto count{ ::epoll_wait(worker.epoll, events.data(), max_events, -1) };
+            if (count < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                break;
+            }
+
+            for (int i{ 0 }; i < count; ++i)
+            {
+                auto* tag{ events[static_cast<size_type>(i)].data.ptr };
+                if (tag == &m_wake)
+                {
+                    stopping = true;
+                }
+                else if (tag == &m_listen)
+                {
+                    accept(worker);
+                }
+                else
+                {
+                    service(worker, *static_cast<session_type*>(tag), events[static_cast<size_type>(i)].events);
+                }
+            }
+        }
+
+        while (!worker.sessions.empty())
+        {
+            close(worker, *worker.sessions.back());
+        }
+    }
+
+    void accept(worker_type& worker)
+    {
+        while (true)
+        {
+            const auto fd{ ::accept4(m_listen, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC) };
+            if (fd < 0)
+            {
+                return;
+            }
+
+            std::pmr::polymorphic_allocator<session_type> allocator{ &worker.arena };
+            auto* session{ allocator.new_object<session_type>(fd, m_disks, &worker.arena) };
+            session->slot = worker.sessions.size();
+            worker.sessions.push_back(session);
+            m_sessions.fetch_add(1, std::memory_order_relaxed);
+
+            if (!watch(worker.epoll, fd, session, EPOLLIN | EPOLLRDHUP, EPOLL_CTL_ADD))
+            {
+                close(worker, *session);
+                continue;
+            }
+
+            session->os << session->game.engine() << '\n';
+            flush(worker, *session);
+        }
+    }
+
+    void service(worker_type& worker, session_type& session, std::uint32_t events)
+    {
+        if ((events & (EPOLLERR | EPOLLHUP)) != 0)
+        {
+            close(worker, session);
+            return;
+        }
+
+        if ((events & EPOLLOUT) != 0 && !flush(worker, session))
+        {
+            return;
+        }
+
+        if ((events & (EPOLLIN | EPOLLRDHUP)) == 0)
+        {
+            return;
+        }
+
+        // Lines are executed block by block and their output flushed, so input holds at most one partial line and
+        // output only what the client has not read yet.
+        bool closed{ false };
+        bool executed{ false };
+        std::array<char, read_block_size> block{};
+        while (session.game.running())
+        {
+            const auto result{ ::read(session.fd, block.data(), block.size()) };
+            if (result > 0)
+            {
+                session.input.append(block.data(), static_cast<size_type>(result));
+                executed |= execute(session);
+                if (!flush(worker, session))
+                {
+                    return;
+                }
+                if (session.input.size() > max_line_size || session.output.size() > max_output_size)
+                {
+                    close(worker, session);
+                    return;
+                }
+                continue;
+            }
+            if (result < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            closed = result == 0 || errno != EAGAIN;
+            break;
+        }
+
+        // A /quit still gets the frame of the position it leaves, so moves sent ahead of it are never left unseen.
+        if (executed)
+        {
+            session.os << session.game.engine() << '\n';
+        }
+
+        if (!flush(worker, session))
+        {
+            return;
+        }
+
+        if (closed || !session.game.running())
+        {
+            close(worker, session);
+        }
+    }
+
+    // Returns true if any line was executed.
+    static bool execute(session_type& session)
+    {
+        std::string_view pending{ session.input };
+        bool executed{ false };
+        for (auto pos{ pending.find('\n') }; session.game.running() && pos != std::string_view::npos;
+             pos = pending.find('\n'))
+        {
+            session.game.execute(pending.substr(0, pos), session.os);
+            pending.remove_prefix(pos + 1);
+            executed = true;
+        }
+        session.input.erase(0, session.input.size() - pending.size());
+        return executed;
+    }
+
+    // Returns false if the session was closed.
+    bool flush(worker_type& worker, session_type& session)
+    {
+        size_type written{ 0 };
+        while (written < session.output.size())
+        {
+            const auto result{ ::send(session.fd, session.output.data() + written, session.output.size() - written,
+                                      MSG_NOSIGNAL) };
+            if (result >= 0)
+            {
+                written += static_cast<size_type>(result);
+                continue;
+            }
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            if (errno != EAGAIN)
+            {
+                close(worker, session);
+                return false;
+            }
+            break;
+        }
+        session.output.erase(0, written);
+
+        if (const auto writable{ session.output.empty() }; writable != session.writable)
+        {
+            session.writable = writable;
+            watch(worker.epoll, session.fd, &session,
+                  EPOLLIN | EPOLLRDHUP | (writable ? 0u : static_cast<std::uint32_t>(EPOLLOUT)), EPOLL_CTL_MOD);
+        }
+        return true;
+    }
+
+    void close(worker_type& worker, session_type& session)
+    {
+        ::epoll_ctl(worker.epoll, EPOLL_CTL_DEL, session.fd, nullptr);
+        ::close(session.fd);
+
+        auto* last{ worker.sessions.back() };
+        last->slot = session.slot;
+        worker.sessions[session.slot] = last;
+        worker.sessions.pop_back();
+
+        std::pmr::polymorphic_allocator<session_type> allocator{ &worker.arena };
+        allocator.delete_object(&session);
+        m_sessions.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+private:
+    game_type::engine_type::mapped_type::size_type m_disks;
+    size_type m_workerCount;
+    std::unique_ptr<worker_type[]> m_workers;
+    int m_listen{ -1 };
+    int m_wake{ -1 };
+    bool m_ok{ false };
+    std::atomic<size_type> m_sessions{ 0 };
+};
@@ -0,0 +1,869 @@
+#include "hanoitower.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <ranges>
+#include <semaphore>
+#include <span>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace
+{
+    template<typename Engine>
+    Engine makeEngine(std::size_t disks, std::size_t pegs = 3)
+    {
+        Engine engine{};
+        for (std::size_t peg{ 0 }; peg < pegs; ++peg)
+        {
+            engine.create(std::string(1, static_cast<char>('a' + peg)));
+        }
+        for (auto disk{ disks }; disk > 0; --disk)
+        {
+            engine.select(PegId{ 0 }).push(static_cast<Engine::tower_type::value_type>(disk));
+        }
+        engine.rehash();
+        return engine;
+    }
+
+    // A snapshot must map back to the same position and journal, and a journal with an entry naming a missing peg
+    // or the same peg twice, or one the position cannot replay, must be refused as the game's /load refuses it.
+    bool testSnapshot()
+    {
+        using tower_type = TheTowerOfHanoi::tower_type;
+        const auto path{ (std::filesystem::temp_directory_path() / "hanoitower-test.snp").string() };
+        const auto loads{ [&path](const TheTowerOfHanoi& engine, const HanoiJournal& journal)
+        {
+            if (!HanoiSnapshot::save(path.c_str(), engine, &journal))
+            {
+                return false;
+            }
+            const auto view{ HanoiSnapshot::map<tower_type>(path.c_str()) };
+            const auto restored{ HanoiSnapshot::restore<tower_type>(view) };
+            const auto restoredJournal{ HanoiSnapshot::restoreJournal(view) };
+            return restored && restored->hash() == engine.hash()
+                   && std::ranges::equal(restoredJournal.entries(), journal.entries())
+                   && restoredJournal.position() == journal.position() && restoredJournal.replays(*restored);
+        } };
+
+        const auto start{ makeEngine<TheTowerOfHanoi>(5) };
+        auto engine{ start };
+        HanoiJournal journal{};
+        for (const auto [from, to]: HanoiMoveView{ 5 } | std::views::take(9))
+        {
+            engine.move(from, to);
+            journal.record({ .from = from, .to = to });
+        }
+        for (std::size_t undone{ 0 }; undone < 3; ++undone)
+        {
+            const auto move{ *journal.undo() };
+            engine.move(move.to, move.from);
+        }
+        const auto single{ [](HanoiMove move)
+        {
+            return HanoiJournal{ HanoiJournal::container_type{ HanoiJournal::encode(move) }, 1 };
+        } };
+
+        const auto ok{ loads(engine, journal) && loads(start, HanoiJournal{}) && loads(TheTowerOfHanoi{}, HanoiJournal{})
+                       && !loads(start, single({ .from = 0, .to = 15 }))
+                       && !loads(start, single({ .from = 0, .to = 0 }))
+                       && !loads(start, single({ .from = 1, .to = 2 })) };
+        std::error_code error{};
+        std::filesystem::remove(path, error);
+        if (!ok)
+        {
+            std::cerr << "test: snapshot round trip failed\n";
+        }
+        return ok;
+    }
+
+    // At every position of the classic solution, each engine's move() and a one-move apply() must accept exactly
+    // the moves TheTowerOfHanoi accepts and leave the same position. Moves to a peg past the last are included, and
+    // a move from a peg to itself must be rejected everywhere.
+    template<std::size_t Disks>
+    bool testMoves()
+    {
+        constexpr std::size_t pegs{ 3 };
+        using static_type = BasicTowerOfHanoi<HanoiStaticTower<TheTowerOfHanoi::tower_type::value_type, Disks>>;
+        auto basic{ makeEngine<TheTowerOfHanoi>(Disks) };
+        auto bounded{ makeEngine<static_type>(Disks) };
+        FixedTowerOfHanoi<pegs, Disks> fixed{};
+        ConcurrentTowerOfHanoi concurrent{ pegs, Disks };
+        PackedTowerOfHanoi packed{ pegs, Disks };
+        PersistentTowerOfHanoi persistent{ pegs, Disks };
+        using batch_type = HanoiBatchEngine<pegs>;
+        batch_type batch{ 1, Disks };
+
+        std::size_t played{ 0 };
+        for (const auto [nextFrom, nextTo]: HanoiMoveView{ Disks })
+        {
+            for (PegId from{ 0 }; from <= pegs; ++from)
+            {
+                for (PegId to{ 0 }; to <= pegs; ++to)
+                {
+                    const HanoiMove move{ .from = from, .to = to };
+                    const std::span moves{ &move, 1 };
+
+                    auto basicMoved{ basic };
+                    auto basicApplied{ basic };
+                    const auto expected{ basicMoved.move(from, to) };
+                    auto boundedMoved{ bounded };
+                    auto boundedApplied{ bounded };
+                    auto fixedMoved{ fixed };
+                    auto fixedApplied{ fixed };
+                    ConcurrentTowerOfHanoi concurrentMoved{ pegs, concurrent.snapshot().assignment() };
+                    ConcurrentTowerOfHanoi concurrentApplied{ pegs, concurrent.snapshot().assignment() };
+                    auto packedMoved{ packed };
+                    auto packedApplied{ packed };
+                    const auto persistentMoved{ persistent.move(from, to) };
+                    const auto [persistentApplied, persistentResult]{ persistent.apply(moves) };
+                    auto batchPlayed{ batch };
+                    const std::array batchFrom{ static_cast<batch_type::id_type>(from) };
+                    const std::array batchTo{ static_cast<batch_type::id_type>(to) };
+
+                    const auto samePacked{ std::ranges::all_of(std::views::iota(std::size_t{ 1 }, Disks + 1),
+                        [&packedMoved, &packedApplied](std::size_t disk)
+                        {
+                            return packedMoved.peg(disk) == packedApplied.peg(disk);
+                        }) };
+                    if (basicApplied.apply(moves).ok != expected || basicMoved.hash() != basicApplied.hash()
+                        || (from == to && expected)
+                        || boundedMoved.move(from, to) != expected || boundedApplied.apply(moves).ok != expected
+                        || boundedMoved.hash() != basicMoved.hash() || boundedApplied.hash() != basicMoved.hash()
+                        || fixedMoved.move(from, to) != expected || fixedApplied.apply(moves).ok != expected
+                        || fixedMoved != fixedApplied
+                        || concurrentMoved.move(from, to) != expected || concurrentApplied.apply(moves).ok != expected
+                        || concurrentMoved.snapshot() != concurrentApplied.snapshot()
+                        || packedMoved.move(from, to) != expected || packedApplied.apply(moves).ok != expected
+                        || !samePacked
+                        || persistentMoved.has_value() != expected || persistentResult.ok != expected
+                        || persistentApplied.hash() != basicMoved.hash()
+                        || (from < pegs && to < pegs && (batchPlayed.step(batchFrom, batchTo) == 1) != expected))
+                    {
+                        std::cerr << "test: moves failed for " << from << " to " << to << " after " << played
+                                  << " moves of " << Disks << " disks\n";
+                        return false;
+                    }
+                }
+            }
+
+            const HanoiMove next{ .from = nextFrom, .to = nextTo };
+            const std::array batchFrom{ static_cast<batch_type::id_type>(nextFrom) };
+            const std::array batchTo{ static_cast<batch_type::id_type>(nextTo) };
+            basic.move(nextFrom, nextTo);
+            bounded.move(nextFrom, nextTo);
+            fixed.move(nextFrom, nextTo);
+            concurrent.move(nextFrom, nextTo);
+            packed.move(nextFrom, nextTo);
+            persistent = persistent.apply({ &next, 1 }).first;
+            batch.step(batchFrom, batchTo);
+            ++played;
+        }
+        return true;
+    }
+
+    // Whether constructing Engine from arguments is refused with std::invalid_argument.
+    template<typename Engine, typename... Args>
+    bool rejects(const Args&... arguments)
+    {
+        try
+        {
+            const Engine engine{ arguments... };
+        }
+        catch (const std::invalid_argument&)
+        {
+            return true;
+        }
+        return false;
+    }
+
+    // Every move a game plays is journaled, so it must refuse more pegs than the journal can name.
+    bool testGameLimits()
+    {
+        const auto layout{ [](std::size_t pegs)
+        {
+            std::string text{ "a:3..1" };
+            for (std::size_t peg{ 1 }; peg < pegs; ++peg)
+            {
+                text += ' ';
+                text += static_cast<char>('a' + peg);
+                text += ':';
+            }
+            return *HanoiLayout::parse(text);
+        } };
+        const auto refuses{ [](PmrTowerOfHanoi engine)
+        {
+            try
+            {
+                const TheTowerOfHanoiGame game{ std::move(engine) };
+            }
+            catch (const std::length_error&)
+            {
+                return true;
+            }
+            return false;
+        } };
+        constexpr auto pegs{ std::size_t{ HanoiJournal::max_pegs } };
+        const auto ok{ TheTowerOfHanoiGame::from(layout(pegs)) && !TheTowerOfHanoiGame::from(layout(pegs + 1))
+                       && !refuses(makeEngine<PmrTowerOfHanoi>(3, pegs))
+                       && refuses(makeEngine<PmrTowerOfHanoi>(3, pegs + 1)) };
+        if (!ok)
+        {
+            std::cerr << "test: game limits failed\n";
+        }
+        return ok;
+    }
+
+    // HanoiStaticVector must construct each element in place and destroy it exactly once, so an element type with
+    // no default constructor works and nothing leaks across copies, moves and pops.
+    bool testStaticVector()
+    {
+        struct label_type
+        {
+            explicit label_type(std::size_t length)
+                    : text(length, 'x')
+            {
+            }
+
+            std::string text;
+
+            bool operator==(const label_type& other) const
+            {
+                return text == other.text;
+            }
+        };
+
+        HanoiStaticVector<label_type, 4> labels{};
+        for (std::size_t length{ 20 }; length < 24; ++length)
+        {
+            labels.emplace_back(length);
+        }
+        auto copy{ labels };
+        labels.pop_back();
+        auto moved{ std::move(copy) };
+        copy = labels;
+        const auto ok{ labels.size() == 3 && moved.size() == 4 && copy == labels && moved.back().text.size() == 23 };
+        if (!ok)
+        {
+            std::cerr << "test: static vector failed\n";
+        }
+        return ok;
+    }
+
+    // A static tower of trivially copyable disks never allocates, so a memcpy of the whole tower must be an
+    // independent copy that compares equal to it.
+    bool testStaticTower()
+    {
+        using tower_type = HanoiStaticTower<std::uint8_t, 64>;
+        tower_type tower{};
+        for (std::uint8_t disk{ 40 }; disk > 0; --disk)
+        {
+            tower.push(disk);
+        }
+        tower_type copy{};
+        std::memcpy(static_cast<void*>(&copy), &tower, sizeof(tower));
+        bool ok{ copy.container() == tower.container() && copy.top() == 1 };
+        copy.pop();
+        ok = ok && copy.size() == tower.size() - 1 && copy.top() == 2 && tower.top() == 1;
+        if (!ok)
+        {
+            std::cerr << "test: static tower failed\n";
+        }
+        return ok;
+    }
+
+    // ConcurrentTowerOfHanoi must accept the most pegs and disks its word holds, and refuse anything past them as
+    // well as a source peg it does not have. PackedTowerOfHanoi must accept no disks at all and refuse a missing
+    // source peg too.
+    bool testEngineLimits()
+    {
+        using concurrent_type = ConcurrentTowerOfHanoi;
+        constexpr auto pegs{ concurrent_type::max_pegs };
+        constexpr auto disks{ concurrent_type::max_disks };
+        const std::vector<PegId> assigned{ 0, 1, 2, 1 };
+        const std::vector<PegId> misassigned{ 0, 1, 3, 1 };
+        const std::vector<PegId> overfull(disks + 1, 0);
+        const auto ok{ !rejects<concurrent_type>(pegs, disks, pegs - 1)
+                       && rejects<concurrent_type>(0uz, 1uz) && rejects<concurrent_type>(pegs + 1, 1uz)
+                       && rejects<concurrent_type>(3uz, disks + 1) && rejects<concurrent_type>(3uz, 4uz, 3uz)
+                       && !rejects<concurrent_type>(3uz, std::span{ assigned })
+                       && rejects<concurrent_type>(3uz, std::span{ misassigned })
+                       && rejects<concurrent_type>(3uz, std::span{ overfull })
+                       && !rejects<PackedTowerOfHanoi>(3uz, 0uz) && rejects<PackedTowerOfHanoi>(3uz, 1uz, 3uz) };
+        if (!ok)
+        {
+            std::cerr << "test: engine limits failed\n";
+        }
+        return ok;
+    }
+
+    bool testLimits()
+    {
+        return testEngineLimits() && testGameLimits();
+    }
+
+    template<typename Engine>
+    Engine decodeEngine(const HanoiStateCodec& codec, HanoiStateCodec::code_type code)
+    {
+        auto engine{ makeEngine<Engine>(0, codec.pegs()) };
+        for (auto disk{ codec.disks() }; disk > 0; --disk)
+        {
+            engine.select(codec.peg(code, disk)).push(static_cast<Engine::tower_type::value_type>(disk));
+        }
+        engine.rehash();
+        return engine;
+    }
+
+    // Shortest distance between two positions by breadth-first search, taking each step through Engine::move so
+    // that the engine's own rules, not the solver's, decide which moves exist.
+    template<typename Engine>
+    std::size_t searchDistance(const HanoiStateCodec& codec, HanoiStateCodec::code_type source,
+                               HanoiStateCodec::code_type target)
+    {
+        constexpr auto unreached{ std::numeric_limits<std::size_t>::max() };
+        std::vector<std::size_t> distance(codec.stateCount(), unreached);
+        std::vector<HanoiStateCodec::code_type> frontier{ source };
+        distance[source] = 0;
+        for (std::size_t next{ 0 }; next < frontier.size() && distance[target] == unreached; ++next)
+        {
+            const auto code{ frontier[next] };
+            for (PegId from{ 0 }; from < codec.pegs(); ++from)
+            {
+                for (PegId to{ 0 }; to < codec.pegs(); ++to)
+                {
+                    auto engine{ decodeEngine<Engine>(codec, code) };
+                    if (!engine.move(from, to))
+                    {
+                        continue;
+                    }
+                    if (const auto moved{ *codec.encode(engine) }; distance[moved] == unreached)
+                    {
+                        distance[moved] = distance[code] + 1;
+                        frontier.push_back(moved);
+                    }
+                }
+            }
+        }
+        return distance[target];
+    }
+
+    // For every small tower and every source and target, the rule policy's solver must play only moves the engine
+    // accepts, end on the target, and match both its own moveCount and the search distance.
+    template<typename Engine>
+    bool testRules(std::string_view label, std::size_t maxDisks)
+    {
+        using rules_type = Engine::rules_type;
+        for (std::size_t disks{ 0 }; disks <= maxDisks; ++disks)
+        {
+            const HanoiStateCodec codec{ 3, disks };
+            for (PegId source{ 0 }; source < 3; ++source)
+            {
+                for (PegId target{ 0 }; target < 3; ++target)
+                {
+                    auto engine{ decodeEngine<Engine>(codec, codec.uniform(source)) };
+                    std::size_t moves{ 0 };
+                    const auto solved{ rules_type::solve(disks, source, target, [&engine, &moves](PegId from, PegId to)
+                    {
+                        ++moves;
+                        return engine.move(from, to);
+                    }) };
+                    if (!solved || codec.encode(engine) != codec.uniform(target)
+                        || rules_type::moveCount(disks, source, target) != moves
+                        || searchDistance<Engine>(codec, codec.uniform(source), codec.uniform(target)) != moves)
+                    {
+                        std::cerr << "test: rules/" << label << " failed for " << disks << " disks from " << source
+                                  << " to " << target << '\n';
+                        return false;
+                    }
+                }
+            }
+        }
+
+        // HanoiRuleSolver must solve a stacked engine and refuse, untouched, one whose disks are split or extra.
+        const HanoiStateCodec codec{ 3, 5 };
+        auto stacked{ decodeEngine<Engine>(codec, codec.uniform(0)) };
+        auto split{ decodeEngine<Engine>(codec, codec.uniform(0) + 1) };
+        const auto hash{ split.hash() };
+        if (!HanoiRuleSolver::solve(stacked, 5, 0, 2) || codec.encode(stacked) != codec.uniform(2)
+            || HanoiRuleSolver::solve(split, 5, 0, 2) || HanoiRuleSolver::solve(split, 4, 1, 2) || split.hash() != hash)
+        {
+            std::cerr << "test: rules/" << label << " solver failed\n";
+            return false;
+        }
+        return true;
+    }
+
+    bool testRules()
+    {
+        return testRules<TheTowerOfHanoi>("classic", 7) && testRules<CyclicTowerOfHanoi>("cyclic", 7)
+               && testRules<AdjacentTowerOfHanoi>("adjacent", 7);
+    }
+
+    // FixedTowerOfHanoi::solve must solve the starting layout, by table or by view, and refuse any other position
+    // without moving a disk.
+    template<std::size_t Disks>
+    bool fixedSolves()
+    {
+        FixedTowerOfHanoi<3, Disks> start{};
+        auto moved{ start };
+        moved.move(0, 2);
+        const auto before{ moved };
+        return start.solve() && start.solved() && !moved.solve() && moved == before;
+    }
+
+    // The engine solver must count its moves, keep the hash current and leave the engine untouched when the pegs
+    // alias or the towers are not a plain stack of disks 1 to n over larger disks. FixedTowerOfHanoi's own solver is
+    // held to the same.
+    bool testSolver()
+    {
+        const auto solves{ [](TheTowerOfHanoi engine, std::size_t disks, PegId source, PegId spare, PegId target)
+        {
+            const auto before{ HanoiStats::snapshot().counter(HanoiCounter::moves) };
+            const auto size{ engine.select(target).size() };
+            if (!TheTowerOfHanoiSolver::solve(engine, disks, source, spare, target))
+            {
+                return false;
+            }
+            const auto moves{ HanoiStats::snapshot().counter(HanoiCounter::moves) - before };
+            auto rehashed{ engine };
+            rehashed.rehash();
+            return engine.select(target).size() == size + disks && engine.select(source).empty()
+                   && rehashed.hash() == engine.hash()
+                   && (!HanoiStats::enabled || moves == TheTowerOfHanoiSolver::moveCount(disks));
+        } };
+        const auto refuses{ [](TheTowerOfHanoi engine, std::size_t disks, PegId source, PegId spare, PegId target)
+        {
+            const auto hash{ engine.hash() };
+            const auto size{ engine.select(source).size() };
+            return !TheTowerOfHanoiSolver::solve(engine, disks, source, spare, target) && engine.hash() == hash
+                   && engine.select(source).size() == size;
+        } };
+        const auto with{ [](TheTowerOfHanoi engine, PegId peg, TheTowerOfHanoi::tower_type::value_type disk)
+        {
+            engine.select(peg).push(disk);
+            engine.rehash();
+            return engine;
+        } };
+
+        auto larger{ makeEngine<TheTowerOfHanoi>(0, 4) };
+        larger.select(PegId{ 3 }).push(20);
+        larger.select(PegId{ 2 }).push(12);
+        for (auto disk{ 10u }; disk > 0; --disk)
+        {
+            larger.select(PegId{ 1 }).push(disk);
+        }
+        larger.rehash();
+
+        const auto engine{ makeEngine<TheTowerOfHanoi>(10) };
+        const auto ok{ solves(engine, 10, 0, 1, 2) && solves(engine, 0, 1, 0, 2) && solves(larger, 10, 1, 2, 3)
+                       && refuses(engine, 10, 0, 0, 2) && refuses(engine, 10, 0, 1, 0) && refuses(engine, 10, 0, 2, 2)
+                       && refuses(engine, 9, 0, 1, 2) && refuses(engine, 11, 0, 1, 2)
+                       && refuses(engine, 10, 0, 1, 3) && refuses(with(engine, 2, 1), 10, 0, 1, 2)
+                       && refuses(makeEngine<TheTowerOfHanoi>(0), 0, 0, 1, 1)
+                       && fixedSolves<5>() && fixedSolves<13>() };
+        if (!ok)
+        {
+            std::cerr << "test: solver failed\n";
+        }
+        return ok;
+    }
+
+    // Every wait() must return only once each task submitted before it has run, across many short rounds in which
+    // workers take tasks the moment they are queued.
+    bool testThreadPool()
+    {
+        HanoiThreadPool pool{ 4 };
+        std::atomic<std::size_t> ran{ 0 };
+        bool ok{ true };
+        for (std::size_t round{ 1 }; ok && round <= 2000; ++round)
+        {
+            for (std::size_t task{ 0 }; task < 8; ++task)
+            {
+                pool.submit([&ran]
+                            {
+                                ran.fetch_add(1, std::memory_order_relaxed);
+                            });
+            }
+            pool.wait();
+            ok = ran.load(std::memory_order_relaxed) == round * 8;
+        }
+        if (!ok)
+        {
+            std::cerr << "test: thread pool failed\n";
+        }
+        return ok;
+    }
+
+    // Frame-Stewart counts must match the known four-peg values, a threaded solve over a shuffled peg list must play
+    // only legal moves and stack every disk on the last listed peg, and a list naming a peg twice must be refused.
+    bool testFrameStewart()
+    {
+        constexpr std::size_t disks{ 17 };
+        const FrameStewartSolver solver{ disks + 3, 6 };
+        HanoiThreadPool pool{ 4 };
+        bool ok{ solver.moveCount(10, 4) == 49 && solver.moveCount(20, 4) == 289 };
+        for (std::size_t pegs{ 3 }; ok && pegs <= 6; ++pegs)
+        {
+            std::vector<PegId> order(pegs);
+            for (std::size_t index{ 0 }; index < pegs; ++index)
+            {
+                order[index] = static_cast<PegId>((index * (pegs - 1) + 1) % pegs);
+            }
+            auto engine{ makeEngine<TheTowerOfHanoi>(0, pegs) };
+            for (auto disk{ disks }; disk > 0; --disk)
+            {
+                engine.select(order.front()).push(static_cast<TheTowerOfHanoi::tower_type::value_type>(disk));
+            }
+            engine.rehash();
+            ok = solver.solve(engine, disks, order, pool) && engine.select(order.back()).size() == disks;
+        }
+        const std::vector<PegId> repeated{ 0, 1, 0, 2 };
+        auto engine{ makeEngine<TheTowerOfHanoi>(disks, 4) };
+        ok = ok && !solver.generate(disks, repeated, pool) && !solver.solve(engine, disks, repeated, pool);
+        if (!ok)
+        {
+            std::cerr << "test: framestewart failed\n";
+        }
+        return ok;
+    }
+
+    // The table must keep the first value inserted for a key and report overflow once probing fails; the codec must
+    // round-trip positions; the parallel search must match the closed-form distance and next move on three pegs and
+    // solve four pegs in the Frame-Stewart count, which is optimal for so few disks.
+    bool testSearch()
+    {
+        HanoiTranspositionTable table{ 4 };
+        bool ok{ table.insert(1, 10) && !table.insert(1, 11) && table.find(1) == 10 && !table.find(2) };
+        for (HanoiTranspositionTable::key_type key{ 2 }; key < 6; ++key)
+        {
+            table.insert(key, key);
+        }
+        ok = ok && table.overflowed();
+
+        HanoiThreadPool pool{ 4 };
+        const HanoiStateCodec codec{ 3, 7 };
+        for (HanoiStateCodec::code_type code{ 0 }; ok && code < codec.stateCount(); code += 37)
+        {
+            const auto target{ static_cast<PegId>(code % 3) };
+            const auto engine{ decodeEngine<TheTowerOfHanoi>(codec, code) };
+            const auto path{ HanoiSearch::shortestPath(codec, code, codec.uniform(target), pool) };
+            const auto distance{ HanoiAnalysis::distance(engine, target) };
+            ok = codec.encode(engine) == code && path && distance && path->size() == *distance
+                 && (path->empty() ? !HanoiAnalysis::nextMove(engine, target)
+                                   : path->front() == HanoiAnalysis::nextMove(engine, target));
+        }
+
+        constexpr std::size_t disks{ 6 };
+        const FrameStewartSolver solver{ disks, 4 };
+        const HanoiStateCodec wide{ 4, disks };
+        auto engine{ makeEngine<TheTowerOfHanoi>(disks, 4) };
+        const auto path{ HanoiSearch::shortestPath(wide, wide.uniform(0), wide.uniform(3), pool) };
+        ok = ok && path && path->size() == solver.moveCount(disks, 4) && HanoiSearch::solve(engine, disks, 3, pool)
+             && engine.select(PegId{ 3 }).size() == disks;
+        if (!ok)
+        {
+            std::cerr << "test: search failed\n";
+        }
+        return ok;
+    }
+
+    // A blocking loopback client of a HanoiSessionHost; reads give up after a few seconds rather than hang the test.
+    class Client
+    {
+    public:
+        explicit Client(std::uint16_t port)
+                : m_fd{ ::socket(AF_INET6, SOCK_STREAM | SOCK_CLOEXEC, 0) }
+        {
+            sockaddr_in6 address{};
+            address.sin6_family = AF_INET6;
+            address.sin6_addr = in6addr_loopback;
+            address.sin6_port = htons(port);
+            const timeval timeout{ .tv_sec = 5, .tv_usec = 0 };
+            ::setsockopt(m_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+            if (::connect(m_fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0)
+            {
+                ::close(m_fd);
+                m_fd = -1;
+            }
+        }
+
+        Client(const Client&) = delete;
+        Client& operator=(const Client&) = delete;
+
+        ~Client()
+        {
+            if (m_fd >= 0)
+            {
+                ::close(m_fd);
+            }
+        }
+
+        [[nodiscard]] bool connected() const
+        {
+            return m_fd >= 0;
+        }
+
+        bool send(std::string_view text) const
+        {
+            return ::send(m_fd, text.data(), text.size(), MSG_NOSIGNAL) == static_cast<ssize_t>(text.size());
+        }
+
+        // Reads size bytes, or fewer if the host closes the session first.
+        [[nodiscard]] std::string receive(std::size_t size) const
+        {
+            std::string text(size, '\0');
+            std::size_t received{ 0 };
+            while (received < size)
+            {
+                const auto result{ ::recv(m_fd, text.data() + received, size - received, 0) };
+                if (result <= 0)
+                {
+                    break;
+                }
+                received += static_cast<std::size_t>(result);
+            }
+            text.resize(received);
+            return text;
+        }
+
+        [[nodiscard]] bool closed() const
+        {
+            char byte{};
+            return ::recv(m_fd, &byte, 1, 0) == 0;
+        }
+
+    private:
+        int m_fd;
+    };
+
+    // Two sessions on one host must each see their own game: the opening frame, nothing for a partial line, the
+    // frame once a line split across two writes completes, and for moves sent with /quit their output and frame
+    // before the session closes. The frames are those a local game of the same size prints.
+    bool testSessions()
+    {
+        constexpr std::size_t disks{ 3 };
+        HanoiSessionHost host{ 0, 2, disks };
+        TheTowerOfHanoiGame first{ disks };
+        TheTowerOfHanoiGame second{ disks };
+        const auto frame{ [](TheTowerOfHanoiGame& game, std::initializer_list<std::string_view> lines)
+        {
+            std::ostringstream os{};
+            game.start();
+            for (const auto line: lines)
+            {
+                game.execute(line, os);
+            }
+            os << game.engine() << '\n';
+            return os.str();
+        } };
+
+        bool ok{ host.ok() && host.port() != 0 };
+        const Client alice{ host.port() };
+        const Client bob{ host.port() };
+        ok = ok && alice.connected() && bob.connected();
+        for (const auto* client: { &alice, &bob })
+        {
+            const auto opening{ frame(client == &alice ? first : second, {}) };
+            ok = ok && client->receive(opening.size()) == opening;
+        }
+
+        ok = ok && alice.send("a,");
+        std::this_thread::sleep_for(std::chrono::milliseconds{ 50 });
+        const auto moved{ frame(first, { "a,c" }) };
+        ok = ok && alice.send("c\n") && alice.receive(moved.size()) == moved;
+
+        const auto quit{ frame(first, { "a,b", "/quit" }) };
+        const auto untouched{ frame(second, { "b,c", "/quit" }) };
+        ok = ok && alice.send("a,b\n/quit\n") && bob.send("b,c\n/quit\n")
+             && alice.receive(quit.size()) == quit && alice.closed()
+             && bob.receive(untouched.size()) == untouched && bob.closed();
+        if (!ok)
+        {
+            std::cerr << "test: sessions failed\n";
+        }
+        return ok;
+    }
+
+    // The coroutine form of the game must yield the same frames a game executing the same lines prints, keep the
+    // journal in step, finish on /quit, and hold the solved frame of a goal game until one more line is sent.
+    bool testGameLoop()
+    {
+        TheTowerOfHanoiGame game{ 3 };
+        TheTowerOfHanoiGame reference{ 3 };
+        const auto frame{ [&reference](std::string_view line)
+        {
+            std::ostringstream os{};
+            reference.execute(line, os);
+            os << reference.engine() << '\n';
+            return os.str();
+        } };
+
+        reference.start();
+        std::ostringstream opening{};
+        opening << reference.engine() << '\n';
+        auto loop{ game.play() };
+        bool ok{ !loop.done() && loop.frame() == opening.str() };
+        ok = ok && loop.send("a,c a,b c,b") && loop.frame() == frame("a,c a,b c,b") && game.journal().position() == 3;
+        ok = ok && loop.send("/undo") && loop.frame() == frame("/undo") && game.journal().position() == 2;
+        ok = ok && !loop.send("/quit") && loop.done();
+
+        const auto start{ HanoiLayout::parse("a:1 b: c:3,2") };
+        const auto target{ HanoiLayout::parse("a: b: c:3..1") };
+        auto goal{ TheTowerOfHanoiGame::from(*start, *target) };
+        auto solving{ goal->play() };
+        ok = ok && solving.send("a,c") && solving.frame().ends_with("solved\n") && !solving.send("") && solving.done();
+        if (!ok)
+        {
+            std::cerr << "test: game loop failed\n";
+        }
+        return ok;
+    }
+
+    // A layout must build the towers it describes even when a run reaches the largest disk value.
+    bool testLayout()
+    {
+        constexpr auto largest{ std::numeric_limits<HanoiLayout::disk_type>::max() };
+        const auto layout{ HanoiLayout::parse("a:" + std::to_string(largest) + ".." + std::to_string(largest - 2)
+                                              + ",5..1 b:" + std::to_string(largest - 3) + " c:") };
+        TheTowerOfHanoi engine{};
+        bool ok{ layout && layout->build(engine) && engine.size() == 3 && engine.select(PegId{ 0 }).size() == 8
+                 && engine.select(PegId{ 0 }).top() == 1 && engine.select(PegId{ 1 }).top() == largest - 3 };
+        if (ok)
+        {
+            auto tower{ engine.select(PegId{ 0 }) };
+            for (auto count{ 5 }; count > 0; --count)
+            {
+                tower.pop();
+            }
+            ok = tower.top() == largest - 2 && layout->matches(engine);
+        }
+        if (!ok)
+        {
+            std::cerr << "test: layout failed\n";
+        }
+        return ok;
+    }
+
+    // Each trace must hold only its own events, and the ring of a thread that traced must be freed once the thread
+    // exits, whether a trace is still running then or not. Without HANOITOWER_ENABLE_TRACE a trace cannot start.
+    bool testTrace()
+    {
+        const auto path{ (std::filesystem::temp_directory_path() / "hanoitower-test.json").string() };
+        if constexpr (!HanoiTrace::enabled)
+        {
+            return !HanoiTrace::start(path.c_str());
+        }
+
+        const auto recorded{ [&path](std::string_view first)
+        {
+            std::ifstream file{ path };
+            const std::string text{ std::istreambuf_iterator<char>{ file }, std::istreambuf_iterator<char>{} };
+            const auto field{ "\"from\":" + std::string{ first } + "," };
+            std::size_t count{ 0 };
+            for (auto pos{ text.find(field) }; pos != std::string::npos; pos = text.find(field, pos + 1))
+            {
+                ++count;
+            }
+            return count;
+        } };
+
+        const auto rings{ HanoiTrace::rings() };
+        bool ok{ HanoiTrace::start(path.c_str()) };
+        {
+            std::vector<std::jthread> threads{};
+            for (std::size_t thread{ 0 }; thread < 4; ++thread)
+            {
+                threads.emplace_back([]
+                                     {
+                                         HanoiTrace::instant(HanoiEvent::move, 1111, 1);
+                                     });
+            }
+        }
+        HanoiTrace::stop();
+        ok = ok && HanoiTrace::rings() == rings && recorded("1111") == 4;
+
+        std::binary_semaphore traced{ 0 };
+        std::binary_semaphore release{ 0 };
+        ok = ok && HanoiTrace::start(path.c_str());
+        std::jthread late{ [&traced, &release]
+                           {
+                               HanoiTrace::instant(HanoiEvent::move, 2222, 1);
+                               traced.release();
+                               release.acquire();
+                               HanoiTrace::instant(HanoiEvent::move, 3333, 1);
+                           } };
+        traced.acquire();
+        HanoiTrace::stop();
+        ok = ok && HanoiTrace::rings() == rings + 1;
+        release.release();
+        late.join();
+        ok = ok && HanoiTrace::rings() == rings && recorded("2222") == 1 && recorded("1111") == 0
+             && recorded("3333") == 0;
+
+        std::error_code error{};
+        std::filesystem::remove(path, error);
+        if (!ok)
+        {
+            std::cerr << "test: trace failed\n";
+        }
+        return ok;
+    }
+
+    using test_type = std::pair<std::string_view, bool (*)()>;
+
+    constexpr std::array tests{
+            test_type{ "snapshot", testSnapshot },
+            test_type{ "moves", testMoves<5> },
+            test_type{ "staticvector", testStaticVector },
+            test_type{ "statictower", testStaticTower },
+            test_type{ "limits", testLimits },
+            test_type{ "rules", testRules },
+            test_type{ "solver", testSolver },
+            test_type{ "threadpool", testThreadPool },
+            test_type{ "framestewart", testFrameStewart },
+            test_type{ "search", testSearch },
+            test_type{ "sessions", testSessions },
+            test_type{ "gameloop", testGameLoop },
+            test_type{ "layout", testLayout },
+            test_type{ "trace", testTrace },
+    };
+}
+
+// Runs the test named by the first argument, or every test when there is none; ctest registers one per name.
+int main(int argc, char* argv[])
+{
+    const std::string_view only{ argc > 1 ? argv[1] : "" };
+    bool ok{ true };
+    bool found{ only.empty() };
+    for (const auto& [name, test]: tests)
+    {
+        if (only.empty() || name == only)
+        {
+            found = true;
+            ok = test() && ok;
+        }
+    }
+    if (!found)
+    {
+        std::cerr << "test: no test named " << only << '\n';
+    }
+    return ok && found ? EXIT_SUCCESS : EXIT_FAILURE;
+}